@@ -0,0 +1,145 @@
+/***************************************************************************
+ * File: batch.h
+ * Author: 朱昱綸 (B11115022@mail.ntust.edu.tw)
+ *         張庭嘉 (B11115027@mail.ntust.edu.tw)
+ *         顏毓德 (B11115038@mail.ntust.edu.tw)
+ *         黃雋祐 (B11115048@mail.ntust.edu.tw)
+ * Create Date: Oct 16, 2026
+ * Update Date: Oct 16, 2026
+ * Description: Streaming analysis of FEN/EPD files, one position per line,
+ *              spread over a pool of threads. (C++20)
+***************************************************************************/
+// Include guard
+#pragma once
+
+// Necessary headers
+#include <algorithm>
+#include <chrono>
+#include <istream>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "draw.h"
+#include "fen.h"
+#include "movegen.h"
+#include "pool.h"
+#include "search.h"
+
+struct BatchOptions {
+  unsigned threads = 1;
+  unsigned depth = 0;       // depth of the optional search, 0 skips it
+  size_t chunkLines = 4096; // lines read, analyzed and written at a time
+};
+
+struct BatchStats {
+  uint64_t positions = 0;
+  uint64_t invalid = 0;
+  double seconds = 0;
+};
+
+// Intent: Cut the FEN part out of a FEN or EPD line: the first 6 fields if the 5th and 6th
+//         are the clocks, otherwise the first 4 (EPD operations such as "bm e4;" follow them)
+// Pre: None
+// Post: The result is a view into line, possibly empty
+constexpr std::string_view fenOfLine(std::string_view line) {
+  size_t end = 0, fields = 0, fourth = std::string_view::npos;
+  while (fields < 6) {
+    size_t start = line.find_first_not_of(' ', end);
+    if (start == std::string_view::npos)
+      break;
+    end = std::min(line.find(' ', start), line.size());
+    if (fields >= 4 && !std::all_of(line.begin() + start, line.begin() + end, isDigit))
+      break;
+    if (++fields == 4)
+      fourth = end;
+  }
+  return fields == 6 ? line.substr(0, end) : fields >= 4 ? line.substr(0, fourth) : line.substr(0, end);
+}
+
+// Intent: Analyze one FEN or EPD line into one tab-separated output line:
+//           "<FEN>\t<state>\t<legal moves>\t<check|->\t<score|->"
+//         the state is one of playing, checkmate, stalemate, insufficient-material, fifty-move
+//         or invalid, the same order as getGameState, repetitions cannot be seen from one line,
+//         the score is from the side to move's point of view and only present if depth != 0
+// Pre: tt != nullptr if depth != 0, its searches are independent so that the score does not
+//      depend on the lines analyzed before
+// Post: The FEN field is copied as it was read, a trailing '\r' is ignored
+inline std::string analyzeLine(std::string_view line, unsigned depth, TranspositionTable *tt) {
+  if (line.size() && line.back() == '\r')
+    line.remove_suffix(1);
+  std::string_view fen = fenOfLine(line);
+  std::string result(fen);
+
+  Position pos;
+  if (readFEN(fen, pos) != PARSE_OK)
+    return result + "\tinvalid\t0\t-\t-";
+
+  MoveList moves;
+  generateLegalMoves(pos, moves);
+  bool inCheck = pos.inCheck();
+  if (!moves.size()) {
+    result += inCheck ? "\tcheckmate\t" : "\tstalemate\t";
+  } else {
+    switch (drawReason(pos, nullptr)) {
+      case DRAW_INSUFFICIENT_MATERIAL: result += "\tinsufficient-material\t"; break;
+      case DRAW_FIFTY_MOVES: result += "\tfifty-move\t"; break;
+      default: result += "\tplaying\t"; break;
+    }
+  }
+  result += std::to_string(moves.size());
+  result += inCheck ? "\tcheck\t" : "\t-\t";
+
+  if (depth && moves.size()) {
+    result += std::to_string(search(pos, {.depth = depth}, *tt).score);
+  } else {
+    result += '-';
+  }
+  return result;
+}
+
+// Intent: Analyze every line of in and write the results to out in input order, reading
+//         options.chunkLines lines at a time so the input is never held in memory as a whole
+// Pre: options.threads >= 1, options.chunkLines >= 1
+// Post: Blank lines are skipped, every other line produces exactly one output line
+inline BatchStats analyzeBatch(std::istream &in, std::ostream &out, const BatchOptions &options) {
+  auto start = std::chrono::steady_clock::now();
+  BatchStats stats;
+  std::vector<std::string> lines, results;
+
+  // each worker has its own small table for the optional search, left over entries of the
+  // lines before read as empty instead of being cleared for each line
+  WorkerPool pool(options.threads);
+  std::vector<std::unique_ptr<TranspositionTable>> tables(pool.size());
+  if (options.depth) {
+    for (auto &tt : tables) {
+      tt = std::make_unique<TranspositionTable>(1);
+      tt->setIndependentSearches(true);
+    }
+  }
+
+  while (true) {
+    lines.clear();
+    for (std::string line; lines.size() < options.chunkLines && std::getline(in, line); )
+      if (line.find_first_not_of(" \t\r") != std::string::npos)
+        lines.push_back(std::move(line));
+    if (lines.empty())
+      break;
+
+    results.resize(lines.size());
+    pool.run(lines.size(), [&](size_t i, unsigned worker) {
+      results[i] = analyzeLine(lines[i], options.depth, tables[worker].get());
+    });
+
+    for (const std::string &result : results) {
+      out << result << '\n';
+      stats.invalid += result.find("\tinvalid\t") != std::string::npos;
+    }
+    stats.positions += results.size();
+  }
+
+  out.flush();
+  stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  return stats;
+}
@@ -0,0 +1,371 @@
+/***************************************************************************
+ * File: bitboard.h
+ * Author: 朱昱綸 (B11115022@mail.ntust.edu.tw)
+ *         張庭嘉 (B11115027@mail.ntust.edu.tw)
+ *         顏毓德 (B11115038@mail.ntust.edu.tw)
+ *         黃雋祐 (B11115048@mail.ntust.edu.tw)
+ * Create Date: Oct 16, 2026
+ * Update Date: Oct 16, 2026
+ * Description: 64-bit square sets and attack tables generated at compile
+ *              time. Sliding attacks use magic bitboards, or PEXT when
+ *              compiled with BMI2 (e.g. -mbmi2 or -march=native) unless
+ *              NO_PEXT is defined. The em++ build always uses magics. (C++20)
+***************************************************************************/
+// Include guard
+#pragma once
+
+// Necessary headers
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <utility>
+
+#if defined(__BMI2__) && !defined(NO_PEXT)
+  #include <immintrin.h>
+  #define USE_PEXT
+#endif
+
+// Bit i is set if square i (same numbering as Position::board, "a8" == 0) is in the set
+using Bitboard = uint64_t;
+
+constexpr Bitboard FILE_A = 0x0101010101010101ull;
+constexpr Bitboard FILE_H = FILE_A << 7;
+constexpr Bitboard RANK_8 = 0xFFull;
+constexpr Bitboard RANK_1 = RANK_8 << 56;
+
+// Intent: Get the set containing only square sq
+// Pre: sq <= 63
+// Post: None
+constexpr Bitboard bit(unsigned sq) { return Bitboard(1) << sq; }
+
+// Intent: Get the set of squares on row y (y == 0 is rank 8)
+// Pre: y <= 7
+// Post: None
+constexpr Bitboard rowBB(unsigned y) { return RANK_8 << (8 * y); }
+
+// Intent: Count the squares in a set
+// Pre: None
+// Post: None
+constexpr int popCount(Bitboard b) { return std::popcount(b); }
+
+// Intent: Get the lowest square in a set
+// Pre: b != 0
+// Post: None
+constexpr uint8_t lsb(Bitboard b) { return uint8_t(std::countr_zero(b)); }
+
+// Intent: Remove the lowest square from a set and return it
+// Pre: b != 0
+// Post: b has one square less
+constexpr uint8_t popLsb(Bitboard &b) {
+  uint8_t sq = lsb(b);
+  b &= b - 1;
+  return sq;
+}
+
+// Intent: Shift every square of a set one step in a direction, dropping squares that leave the board
+// Pre: None
+// Post: None
+constexpr Bitboard shiftNorth(Bitboard b) { return b >> 8; }
+constexpr Bitboard shiftSouth(Bitboard b) { return b << 8; }
+constexpr Bitboard shiftEast(Bitboard b) { return (b << 1) & ~FILE_A; }
+constexpr Bitboard shiftWest(Bitboard b) { return (b >> 1) & ~FILE_H; }
+
+// Intent: Gather the bits of value selected by mask into the low bits, like the PEXT instruction
+// Pre: None
+// Post: Only used while the tables are generated, the lookups use the instruction itself
+constexpr Bitboard softwarePext(Bitboard value, Bitboard mask) {
+  Bitboard result = 0;
+  for (Bitboard bb = 1; mask; mask &= mask - 1, bb <<= 1)
+    if (value & mask & -mask)
+      result |= bb;
+  return result;
+}
+
+// Lookup data of a sliding piece on one square
+struct Magic {
+  Bitboard mask;             // relevant occupancy, board edges excluded
+  Bitboard magic;
+  const Bitboard *attacks;   // first entry of this square in its attack table
+  unsigned shift;
+
+  // Intent: Map an occupancy to the index of its attack set
+  // Pre: None
+  // Post: result < (1 << popCount(mask))
+  constexpr unsigned index(Bitboard occupied) const {
+#ifdef USE_PEXT
+    if (std::is_constant_evaluated())
+      return unsigned(softwarePext(occupied, mask));
+    return unsigned(_pext_u64(occupied, mask));
+#else
+    return unsigned(((occupied & mask) * magic) >> shift);
+#endif
+  }
+};
+
+// Magic multipliers found offline for this square numbering (unused with PEXT)
+constexpr Bitboard ROOK_MAGIC_NUMBERS[64] = {
+  0x0280132180004001ull, 0x0140001000200040ull, 0x0880200010000880ull, 0x2080080005801000ull,
+  0x0200041020080200ull, 0x0200041041084200ull, 0x0400080081124410ull, 0x2180042100004080ull,
+  0x8000800099644000ull, 0x0802003040820100ull, 0x0105801001862000ull, 0x0101002008100100ull,
+  0x1000800400080080ull, 0x0804800200040080ull, 0x2001800200800900ull, 0x00160004088204c1ull,
+  0x228000c001402000ull, 0x8510004000200050ull, 0x3001848020029000ull, 0x0280808010000801ull,
+  0x0109010010040800ull, 0x8000808004000200ull, 0x8000040081021028ull, 0x40040a0009004884ull,
+  0x80c0004280008035ull, 0x0010004040002000ull, 0x1101200500410070ull, 0x8410100080080080ull,
+  0x000c080080800400ull, 0x4012008080040002ull, 0x4000040101000200ull, 0x0061010200008044ull,
+  0x0080804010800020ull, 0x3000201008400040ull, 0x4112008012002444ull, 0x0848000880801000ull,
+  0x00a8008008800400ull, 0x200200280a00500cull, 0x080a221024004801ull, 0xc400008042000104ull,
+  0x8000400080028022ull, 0x0220008040018020ull, 0x4000200011010040ull, 0x10060040210a0010ull,
+  0x40820020904a0004ull, 0x0030040002008080ull, 0x0200020801840010ull, 0x0084c04100820004ull,
+  0x4802010080c2a600ull, 0x0000400080201880ull, 0x2040801000200080ull, 0x0180200842001200ull,
+  0x0013510008000500ull, 0x0182000c00808a80ull, 0x1000524821302400ull, 0x3800040108488200ull,
+  0x104a004810210082ull, 0x0004210010420082ull, 0xc424110008200241ull, 0x90101000a0088501ull,
+  0x0182000420100802ull, 0x4822001001080402ull, 0x05d0080090012204ull, 0x2008140089042846ull,
+};
+
+constexpr Bitboard BISHOP_MAGIC_NUMBERS[64] = {
+  0x0420220228022c80ull, 0x200208010c108000ull, 0x1004010411040040ull, 0x12a4040292002440ull,
+  0x0804042082000850ull, 0x0802020220010440ull, 0x800401048260201aull, 0x0041010800828800ull,
+  0x4040641488080104ull, 0x20002004016e0020ull, 0x0c2c223a12420042ull, 0x0100024081020220ull,
+  0x0383211041025080ull, 0x08c0030420160600ull, 0x0c1000510808c00aull, 0x40501a0084140280ull,
+  0x40280040112c0088ull, 0x4020040908110050ull, 0x1028001008801412ull, 0x0104220202020000ull,
+  0x800a000400940010ull, 0x0401000200512410ull, 0x1082012100900408ull, 0x0101402208440c00ull,
+  0x00482104c01c1111ull, 0x0310105008017101ull, 0x0022010108080020ull, 0x02300400104010a0ull,
+  0x1401010011444000ull, 0x1001020000405020ull, 0x00010a0804480411ull, 0x0419220010404400ull,
+  0x0010020a00200820ull, 0xa008280909040104ull, 0x0210209010080020ull, 0x3006110800040040ull,
+  0x0800820200440090ull, 0x0008100421810080ull, 0x0028060093264800ull, 0x0a08004088810080ull,
+  0x3611100290442000ull, 0x0241081282001001ull, 0x11081108010d0800ull, 0x002a102014420800ull,
+  0x480002600a004500ull, 0x8001010102000100ull, 0x2008080810410883ull, 0x0002080901101022ull,
+  0x2800942420444080ull, 0x2000840108024000ull, 0x0000804844100040ull, 0x1444120020884540ull,
+  0x0004001002020c00ull, 0x041041c801010049ull, 0x0060045000850810ull, 0x1003240c14820208ull,
+  0x3010104a10100800ull, 0x0280020101580200ull, 0x1000000101081600ull, 0x0644009800420200ull,
+  0x0050040008102402ull, 0x00000004601c8106ull, 0x00088530040812a0ull, 0x800218010102020cull,
+};
+
+// Ray directions as (dx, dy) steps, y grows toward rank 1; the rook uses the first 4, the bishop the last 4
+enum Direction : uint8_t { EAST, SOUTH, WEST, NORTH, SOUTH_EAST, SOUTH_WEST, NORTH_EAST, NORTH_WEST };
+constexpr int DIRECTION_STEPS[8][2] = {{1, 0}, {0, 1}, {-1, 0}, {0, -1}, {1, 1}, {-1, 1}, {1, -1}, {-1, -1}};
+constexpr Direction ROOK_DIRS[4] = {EAST, SOUTH, WEST, NORTH};
+constexpr Direction BISHOP_DIRS[4] = {SOUTH_EAST, SOUTH_WEST, NORTH_EAST, NORTH_WEST};
+
+// Intent: Check if squares along a direction have growing indices
+// Pre: None
+// Post: None
+constexpr bool isIncreasing(Direction dir) { return dir == EAST || dir == SOUTH || dir == SOUTH_EAST || dir == SOUTH_WEST; }
+
+// Squares from a square to the board edge in one direction, the square itself excluded
+constexpr auto RAYS = [] {
+  std::array<std::array<Bitboard, 64>, 8> table{};
+  for (unsigned dir = 0; dir < 8; ++dir) {
+    auto [dx, dy] = DIRECTION_STEPS[dir];
+    for (unsigned sq = 0; sq < 64; ++sq)
+      for (int x = int(sq % 8) + dx, y = int(sq / 8) + dy; x >= 0 && x <= 7 && y >= 0 && y <= 7; x += dx, y += dy)
+        table[dir][sq] |= bit(y * 8 + x);
+  }
+  return table;
+}();
+
+// Intent: Compute the attacks of a slider along 4 directions from the rays, the nearest
+//         blocker of each ray cuts off the ray behind it
+// Pre: sq <= 63
+// Post: None
+constexpr Bitboard slidingAttacks(unsigned sq, Bitboard occupied, const Direction (&dirs)[4]) {
+  Bitboard result = 0;
+  for (Direction dir : dirs) {
+    Bitboard ray = RAYS[dir][sq], blockers = ray & occupied;
+    if (blockers)
+      ray ^= RAYS[dir][isIncreasing(dir) ? lsb(blockers) : 63 - std::countl_zero(blockers)];
+    result |= ray;
+  }
+  return result;
+}
+
+// Every table below is generated by the compiler and stored in the binary, nothing is
+// computed at startup and the lookups need no bounds checks
+
+constexpr auto PAWN_ATTACKS = [] { // indexed by Color
+  std::array<std::array<Bitboard, 64>, 2> table{};
+  for (unsigned sq = 0; sq < 64; ++sq) {
+    Bitboard b = bit(sq);
+    table[0][sq] = shiftNorth(shiftEast(b) | shiftWest(b));
+    table[1][sq] = shiftSouth(shiftEast(b) | shiftWest(b));
+  }
+  return table;
+}();
+
+constexpr auto KNIGHT_ATTACKS = [] {
+  std::array<Bitboard, 64> table{};
+  for (unsigned sq = 0; sq < 64; ++sq) {
+    Bitboard b = bit(sq);
+    Bitboard h1 = shiftEast(b) | shiftWest(b), h2 = shiftEast(shiftEast(b)) | shiftWest(shiftWest(b));
+    table[sq] = shiftNorth(shiftNorth(h1)) | shiftSouth(shiftSouth(h1)) | shiftNorth(h2) | shiftSouth(h2);
+  }
+  return table;
+}();
+
+constexpr auto KING_ATTACKS = [] {
+  std::array<Bitboard, 64> table{};
+  for (unsigned sq = 0; sq < 64; ++sq) {
+    Bitboard b = bit(sq), h1 = shiftEast(b) | shiftWest(b);
+    table[sq] = h1 | shiftNorth(h1 | b) | shiftSouth(h1 | b);
+  }
+  return table;
+}();
+
+// Intent: Get the relevant occupancy of a slider, the last square of each ray never blocks
+// Pre: sq <= 63
+// Post: None
+constexpr Bitboard sliderMask(unsigned sq, const Direction (&dirs)[4]) {
+  Bitboard edges = ((RANK_8 | RANK_1) & ~rowBB(sq / 8)) | ((FILE_A | FILE_H) & ~(FILE_A << (sq % 8)));
+  return slidingAttacks(sq, 0, dirs) & ~edges;
+}
+
+// Intent: Count the attack table entries of the 8 squares of row y
+// Pre: y <= 7
+// Post: None
+constexpr size_t sliderRowSize(const Direction (&dirs)[4], unsigned y) {
+  size_t result = 0;
+  for (unsigned sq = y * 8; sq < y * 8 + 8; ++sq)
+    result += size_t(1) << popCount(sliderMask(sq, dirs));
+  return result;
+}
+
+// Magic lookups of the 8 squares of one row and their attack table, one row is generated per
+// constant evaluation so that the default constexpr limits of the compilers are enough
+template <size_t N>
+struct SliderRow {
+  Magic magics[8];     // attacks is set once the row has its final address
+  size_t offsets[8];
+  Bitboard attacks[N];
+  bool valid;          // false if two occupancies of a square collide on different attacks
+};
+
+// Intent: Fill the magic lookups of row y for one slider type
+// Pre: N == sliderRowSize(dirs, y)
+// Post: Every subset of every mask is stored, result.valid tells if the magic numbers work
+template <size_t N>
+constexpr SliderRow<N> makeSliderRow(const Bitboard (&numbers)[64], const Direction (&dirs)[4], unsigned y) {
+  SliderRow<N> result{};
+  size_t offset = 0;
+  result.valid = true;
+  for (unsigned x = 0; x < 8; ++x) {
+    unsigned sq = y * 8 + x;
+    Magic &m = result.magics[x];
+    m.mask = sliderMask(sq, dirs);
+    m.magic = numbers[sq];
+    m.shift = 64 - popCount(m.mask);
+    result.offsets[x] = offset;
+
+    // enumerate all subsets of the mask (Carry-Rippler trick), attack sets are never empty
+    Bitboard occupied = 0;
+    do {
+      Bitboard &entry = result.attacks[offset + m.index(occupied)];
+      Bitboard attacks = slidingAttacks(sq, occupied, dirs);
+      result.valid = result.valid && (!entry || entry == attacks);
+      entry = attacks;
+      occupied = (occupied - m.mask) & m.mask;
+    } while (occupied);
+    offset += size_t(1) << popCount(m.mask);
+  }
+  return result;
+}
+
+template <const Direction (&dirs)[4], const Bitboard (&numbers)[64], unsigned y>
+constexpr auto SLIDER_ROW = makeSliderRow<sliderRowSize(dirs, y)>(numbers, dirs, y);
+
+// Intent: Collect the lookups of the 8 rows of one slider type, pointing into the row tables
+// Pre: None
+// Post: None
+template <const Direction (&dirs)[4], const Bitboard (&numbers)[64]>
+constexpr std::array<Magic, 64> collectMagics() {
+  std::array<Magic, 64> result{};
+  auto collect = [&](const auto &row, unsigned y) {
+    for (unsigned x = 0; x < 8; ++x) {
+      result[y * 8 + x] = row.magics[x];
+      result[y * 8 + x].attacks = row.attacks + row.offsets[x];
+    }
+  };
+  [&]<unsigned... y>(std::integer_sequence<unsigned, y...>) {
+    (collect(SLIDER_ROW<dirs, numbers, y>, y), ...);
+  }(std::make_integer_sequence<unsigned, 8>{});
+  return result;
+}
+
+// Intent: Check the magic numbers of every row of one slider type
+// Pre: None
+// Post: None
+template <const Direction (&dirs)[4], const Bitboard (&numbers)[64]>
+constexpr bool validMagics() {
+  return [&]<unsigned... y>(std::integer_sequence<unsigned, y...>) {
+    return (SLIDER_ROW<dirs, numbers, y>.valid && ...);
+  }(std::make_integer_sequence<unsigned, 8>{});
+}
+
+constexpr auto ROOK_MAGICS = collectMagics<ROOK_DIRS, ROOK_MAGIC_NUMBERS>();
+constexpr auto BISHOP_MAGICS = collectMagics<BISHOP_DIRS, BISHOP_MAGIC_NUMBERS>();
+
+// Squares strictly between two aligned squares, and the whole line through them, else 0
+struct AlignmentTables {
+  Bitboard between[64][64];
+  Bitboard line[64][64];
+};
+
+constexpr AlignmentTables ALIGNMENT = [] {
+  AlignmentTables result{};
+  // two squares are aligned if one is on an empty-board ray of the other
+  for (unsigned a = 0; a < 64; ++a) {
+    for (const auto *dirs : {&ROOK_DIRS, &BISHOP_DIRS}) {
+      Bitboard rays = slidingAttacks(a, 0, *dirs);
+      for (Bitboard b = rays; b; ) {
+        unsigned c = popLsb(b);
+        result.line[a][c] = (rays & slidingAttacks(c, 0, *dirs)) | bit(a) | bit(c);
+        result.between[a][c] = slidingAttacks(a, bit(c), *dirs) & slidingAttacks(c, bit(a), *dirs);
+      }
+    }
+  }
+  return result;
+}();
+
+constexpr const auto &BETWEEN = ALIGNMENT.between;
+constexpr const auto &LINE = ALIGNMENT.line;
+
+// Intent: Count the squares of every set in a table, used by the checks below
+// Pre: None
+// Post: None
+template <typename Table>
+constexpr int totalSquares(const Table &table) {
+  int result = 0;
+  for (const auto &entry : table) {
+    if constexpr (std::is_same_v<std::decay_t<decltype(entry)>, Bitboard>)
+      result += popCount(entry);
+    else
+      result += totalSquares(entry);
+  }
+  return result;
+}
+
+// Reference counts on an empty board: 896 rook and 560 bishop moves, 336 knight moves, 420 king
+// moves, 98 pawn captures per color, 2576 squares between the ordered pairs of aligned squares,
+// 0x19000 rook and 0x1480 bishop attack sets; magics without destructive collisions
+static_assert(totalSquares(RAYS) == 896 + 560);
+static_assert(totalSquares(KNIGHT_ATTACKS) == 336 && totalSquares(KING_ATTACKS) == 420);
+static_assert(totalSquares(PAWN_ATTACKS[0]) == 98 && totalSquares(PAWN_ATTACKS[1]) == 98);
+static_assert([] {
+  size_t rook = 0, bishop = 0;
+  for (unsigned y = 0; y < 8; ++y)
+    rook += sliderRowSize(ROOK_DIRS, y), bishop += sliderRowSize(BISHOP_DIRS, y);
+  return rook == 0x19000 && bishop == 0x1480;
+}());
+static_assert(validMagics<ROOK_DIRS, ROOK_MAGIC_NUMBERS>() && validMagics<BISHOP_DIRS, BISHOP_MAGIC_NUMBERS>());
+static_assert(totalSquares(BETWEEN) == 2576 && LINE[0][63] == 0x8040201008040201ull && !LINE[0][10]);
+
+// Intent: Get the squares attacked by a rook or a bishop on sq
+// Pre: sq <= 63
+// Post: None
+constexpr Bitboard rookAttacks(unsigned sq, Bitboard occupied) {
+  return ROOK_MAGICS[sq].attacks[ROOK_MAGICS[sq].index(occupied)];
+}
+constexpr Bitboard bishopAttacks(unsigned sq, Bitboard occupied) {
+  return BISHOP_MAGICS[sq].attacks[BISHOP_MAGICS[sq].index(occupied)];
+}
@@ -0,0 +1,97 @@
+/***************************************************************************
+ * File: draw.h
+ * Author: 朱昱綸 (B11115022@mail.ntust.edu.tw)
+ *         張庭嘉 (B11115027@mail.ntust.edu.tw)
+ *         顏毓德 (B11115038@mail.ntust.edu.tw)
+ *         黃雋祐 (B11115048@mail.ntust.edu.tw)
+ * Create Date: Oct 16, 2026
+ * Update Date: Oct 16, 2026
+ * Description: Draw rules that need more than the legal moves: threefold
+ *              repetition over a ring buffer of position keys, the
+ *              fifty-move rule and insufficient material. (C++20)
+***************************************************************************/
+// Include guard
+#pragma once
+
+// Necessary headers
+#include <algorithm>
+#include <cstdint>
+#include "position.h"
+
+enum DrawReason : uint8_t { NO_DRAW, DRAW_INSUFFICIENT_MATERIAL, DRAW_FIFTY_MOVES, DRAW_REPETITION };
+
+// Squares of the same color as "a8"
+constexpr Bitboard LIGHT_SQUARES = 0xAA55AA55AA55AA55ull;
+
+// Intent: Get the key used to compare positions for repetitions, an en passant square counts
+//         only if a pawn of the side to move stands next to it
+// Pre: None
+// Post: result == pos.key if pos.enPassant == NO_SQUARE
+constexpr uint64_t repetitionKey(const Position &pos) {
+  if (pos.enPassant == NO_SQUARE || PAWN_ATTACKS[!pos.activeColor][pos.enPassant] & pos.pieces(pos.activeColor, PAWN))
+    return pos.key;
+  return pos.key ^ ZOBRIST.enPassant[pos.enPassant % 8];
+}
+
+// Keys of the positions played before the current one. A capture or a pawn move makes every
+// earlier position unreachable, so no lookup goes further back than the halfmove clock, and
+// the fifty-move rule ends the game before the clock passes the capacity.
+class KeyHistory {
+public:
+  static constexpr size_t CAPACITY = 128;
+
+  // Intent: Record the position a move is about to be played from, or its repetitionKey
+  // Pre: None
+  // Post: The oldest key is overwritten once CAPACITY keys are stored
+  constexpr void push(const Position &pos) { push(repetitionKey(pos)); }
+  constexpr void push(uint64_t key) { keys[count++ % CAPACITY] = key; }
+
+  // Intent: Forget every position
+  // Pre: None
+  // Post: size() == 0
+  constexpr void clear() { count = 0; }
+
+  constexpr size_t size() const { return count; }
+
+  // Intent: Count how often pos occurred before, looking only at the same side to move
+  //         within the last pos.halfmoveClock plies
+  // Pre: pos is the position reached after the last pushed position
+  // Post: result <= min(pos.halfmoveClock, size(), CAPACITY) / 2
+  constexpr unsigned repetitions(const Position &pos) const {
+    uint64_t key = repetitionKey(pos);
+    size_t reach = std::min({size_t(pos.halfmoveClock), count, CAPACITY});
+    unsigned result = 0;
+    for (size_t back = 2; back <= reach; back += 2)
+      result += keys[(count - back) % CAPACITY] == key;
+    return result;
+  }
+
+private:
+  uint64_t keys[CAPACITY] = {};
+  size_t count = 0;
+};
+
+// Intent: Check if neither side can ever checkmate: kings alone, one minor piece left,
+//         or only bishops that all stand on squares of one color
+// Pre: None
+// Post: None
+constexpr bool isInsufficientMaterial(const Position &pos) {
+  if (pos.byType[PAWN] | pos.byType[ROOK] | pos.byType[QUEEN])
+    return false;
+  if (popCount(pos.byType[KNIGHT] | pos.byType[BISHOP]) <= 1)
+    return true;
+  return !pos.byType[KNIGHT] && (!(pos.byType[BISHOP] & LIGHT_SQUARES) || !(pos.byType[BISHOP] & ~LIGHT_SQUARES));
+}
+
+// Intent: Get the rule that draws pos, checkmate and stalemate are left to the caller
+// Pre: history is nullptr or holds the positions played before pos
+// Post: Repetitions are only found if history != nullptr
+constexpr DrawReason drawReason(const Position &pos, const KeyHistory *history) {
+  if (isInsufficientMaterial(pos))
+    return DRAW_INSUFFICIENT_MATERIAL;
+  if (pos.halfmoveClock >= 100)
+    return DRAW_FIFTY_MOVES;
+  if (history && history->repetitions(pos) >= 2)
+    return DRAW_REPETITION;
+  return NO_DRAW;
+}
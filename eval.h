@@ -0,0 +1,115 @@
+/***************************************************************************
+ * File: eval.h
+ * Author: 朱昱綸 (B11115022@mail.ntust.edu.tw)
+ *         張庭嘉 (B11115027@mail.ntust.edu.tw)
+ *         顏毓德 (B11115038@mail.ntust.edu.tw)
+ *         黃雋祐 (B11115048@mail.ntust.edu.tw)
+ * Create Date: Oct 16, 2026
+ * Update Date: Oct 16, 2026
+ * Description: Material and piece-square evaluation used by the search.
+ *              (C++20)
+***************************************************************************/
+// Include guard
+#pragma once
+
+// Necessary headers
+#include "position.h"
+
+// Centipawn value of each piece type, indexed by PieceType, the king is never captured
+constexpr int PIECE_VALUES[7] = {0, 100, 320, 330, 500, 900, 0};
+
+// Piece-square bonuses from white's point of view, laid out like the board ("a8" first),
+// black pieces read them through the vertically mirrored square (sq ^ 56)
+constexpr int PST[7][64] = {
+  {},
+  { // pawn
+     0,  0,  0,  0,  0,  0,  0,  0,
+    50, 50, 50, 50, 50, 50, 50, 50,
+    10, 10, 20, 30, 30, 20, 10, 10,
+     5,  5, 10, 25, 25, 10,  5,  5,
+     0,  0,  0, 20, 20,  0,  0,  0,
+     5, -5,-10,  0,  0,-10, -5,  5,
+     5, 10, 10,-20,-20, 10, 10,  5,
+     0,  0,  0,  0,  0,  0,  0,  0},
+  { // knight
+   -50,-40,-30,-30,-30,-30,-40,-50,
+   -40,-20,  0,  0,  0,  0,-20,-40,
+   -30,  0, 10, 15, 15, 10,  0,-30,
+   -30,  5, 15, 20, 20, 15,  5,-30,
+   -30,  0, 15, 20, 20, 15,  0,-30,
+   -30,  5, 10, 15, 15, 10,  5,-30,
+   -40,-20,  0,  5,  5,  0,-20,-40,
+   -50,-40,-30,-30,-30,-30,-40,-50},
+  { // bishop
+   -20,-10,-10,-10,-10,-10,-10,-20,
+   -10,  0,  0,  0,  0,  0,  0,-10,
+   -10,  0,  5, 10, 10,  5,  0,-10,
+   -10,  5,  5, 10, 10,  5,  5,-10,
+   -10,  0, 10, 10, 10, 10,  0,-10,
+   -10, 10, 10, 10, 10, 10, 10,-10,
+   -10,  5,  0,  0,  0,  0,  5,-10,
+   -20,-10,-10,-10,-10,-10,-10,-20},
+  { // rook
+     0,  0,  0,  0,  0,  0,  0,  0,
+     5, 10, 10, 10, 10, 10, 10,  5,
+    -5,  0,  0,  0,  0,  0,  0, -5,
+    -5,  0,  0,  0,  0,  0,  0, -5,
+    -5,  0,  0,  0,  0,  0,  0, -5,
+    -5,  0,  0,  0,  0,  0,  0, -5,
+    -5,  0,  0,  0,  0,  0,  0, -5,
+     0,  0,  0,  5,  5,  0,  0,  0},
+  { // queen
+   -20,-10,-10, -5, -5,-10,-10,-20,
+   -10,  0,  0,  0,  0,  0,  0,-10,
+   -10,  0,  5,  5,  5,  5,  0,-10,
+    -5,  0,  5,  5,  5,  5,  0, -5,
+     0,  0,  5,  5,  5,  5,  0, -5,
+   -10,  5,  5,  5,  5,  5,  0,-10,
+   -10,  0,  5,  0,  0,  0,  0,-10,
+   -20,-10,-10, -5, -5,-10,-10,-20},
+  { // king, middle game
+   -30,-40,-40,-50,-50,-40,-40,-30,
+   -30,-40,-40,-50,-50,-40,-40,-30,
+   -30,-40,-40,-50,-50,-40,-40,-30,
+   -30,-40,-40,-50,-50,-40,-40,-30,
+   -20,-30,-30,-40,-40,-30,-30,-20,
+   -10,-20,-20,-20,-20,-20,-20,-10,
+    20, 20,  0,  0,  0,  0, 20, 20,
+    20, 30, 10,  0,  0, 10, 30, 20},
+};
+
+// The king walks to the center once the queens are off or little material is left
+constexpr int KING_ENDGAME_PST[64] = {
+   -50,-40,-30,-20,-20,-30,-40,-50,
+   -30,-20,-10,  0,  0,-10,-20,-30,
+   -30,-10, 20, 30, 30, 20,-10,-30,
+   -30,-10, 30, 40, 40, 30,-10,-30,
+   -30,-10, 30, 40, 40, 30,-10,-30,
+   -30,-10, 20, 30, 30, 20,-10,-30,
+   -30,-30,  0,  0,  0,  0,-30,-30,
+   -50,-30,-30,-30,-30,-30,-30,-50,
+};
+
+// Intent: Evaluate a position statically
+// Pre: None
+// Post: The score is in centipawns from the point of view of the side to move
+inline int evaluate(const Position &pos) {
+  int score = 0;
+  int nonPawnMaterial = 0;
+
+  for (Bitboard b = pos.occupied() & ~pos.byType[KING]; b; ) {
+    uint8_t sq = popLsb(b);
+    Piece p = pos.board[sq];
+    PieceType t = typeOf(p);
+    int value = PIECE_VALUES[t] + PST[t][colorOf(p) == WHITE ? sq : sq ^ 56];
+    score += colorOf(p) == WHITE ? value : -value;
+    if (t != PAWN)
+      nonPawnMaterial += PIECE_VALUES[t];
+  }
+
+  bool endgame = !pos.byType[QUEEN] || nonPawnMaterial <= 2 * (PIECE_VALUES[QUEEN] + PIECE_VALUES[KNIGHT]);
+  const int *kingTable = endgame ? KING_ENDGAME_PST : PST[KING];
+  score += kingTable[pos.kingSquare[WHITE]] - kingTable[pos.kingSquare[BLACK] ^ 56];
+
+  return pos.activeColor == WHITE ? score : -score;
+}
@@ -0,0 +1,165 @@
+/***************************************************************************
+ * File: fen.h
+ * Author: 朱昱綸 (B11115022@mail.ntust.edu.tw)
+ *         張庭嘉 (B11115027@mail.ntust.edu.tw)
+ *         顏毓德 (B11115038@mail.ntust.edu.tw)
+ *         黃雋祐 (B11115048@mail.ntust.edu.tw)
+ * Create Date: Oct 16, 2026
+ * Update Date: Oct 16, 2026
+ * Description: Single-pass, allocation-free parsers for FEN strings and
+ *              coordinate moves. (C++20)
+***************************************************************************/
+// Include guard
+#pragma once
+
+// Necessary headers
+#include <algorithm>
+#include <string_view>
+#include "position.h"
+#include "stats.h"
+
+// Returned by readFEN and readMove when the whole input is valid
+constexpr size_t PARSE_OK = std::string_view::npos;
+
+// A move in the coordinate format used by getNextFEN, e.g. "e2e4" or "e7e8Q"
+struct CoordMove {
+  uint8_t from;
+  uint8_t to;
+  Piece promotion; // NO_PIECE if the move is not a promotion
+};
+
+// Intent: Check if a character is a decimal digit (std::isdigit is not constexpr)
+// Pre: None
+// Post: None
+constexpr bool isDigit(char c) { return c >= '0' && c <= '9'; }
+
+// Intent: Parse a FEN string into pos in a single pass, the accepted format is
+//           "<board> <w|b> <-|KQkq> <-|en passant square> <halfmove clock> <fullmove number>"
+//         Both clocks may be left out together ("incomplete FEN"), they default to 0 and 1.
+//         Clocks too large for their field are clamped.
+// Pre: None
+// Post: Return PARSE_OK if fen is valid, otherwise the index of the first offending character
+//       (fen.size() if fen ends too early), pos is unspecified in that case
+constexpr size_t readFEN(std::string_view fen, Position &pos) {
+  STAT_COUNT(STAT_FEN_PARSES);
+  size_t i = 0;
+  auto peek = [&] { return i < fen.size() ? fen[i] : '\0'; };
+  auto expect = [&](char c) { return peek() == c ? (++i, true) : false; };
+
+  // a missing king and "-" for en passant are NO_SQUARE, the zeroed square would be a8
+  pos = {};
+  pos.kingSquare[WHITE] = pos.kingSquare[BLACK] = pos.enPassant = NO_SQUARE;
+
+  // chess board, each row has to be exactly 8 squares long
+  for (size_t y = 0; y < 8; ++y) {
+    if (y && !expect('/'))
+      return i;
+    for (size_t x = 0; x < 8; ++i) {
+      char c = peek();
+      Piece p = charToPiece(c);
+      if (c >= '1' && c <= '8' && x + (c - '0') <= 8) {
+        x += c - '0';
+      } else if (p == NO_PIECE) {
+        return i;
+      } else {
+        // each side has to have exactly 1 king
+        if (typeOf(p) == KING && pos.kingSquare[colorOf(p)] != NO_SQUARE)
+          return i;
+        pos.put(xy2sq(x++, y), p);
+      }
+    }
+  }
+  if (pos.kingSquare[WHITE] == NO_SQUARE || pos.kingSquare[BLACK] == NO_SQUARE)
+    return i;
+
+  // active color
+  if (!expect(' '))
+    return i;
+  if (expect('w'))
+    pos.activeColor = WHITE;
+  else if (expect('b'))
+    pos.activeColor = BLACK;
+  else
+    return i;
+
+  // castling rights, 1 to 4 letters
+  if (!expect(' '))
+    return i;
+  if (!expect('-')) {
+    size_t n = 0;
+    for (; n < 4; ++n, ++i) {
+      char c = peek();
+      uint8_t right = c == 'K' ? WHITE_OO : c == 'Q' ? WHITE_OOO : c == 'k' ? BLACK_OO : c == 'q' ? BLACK_OOO : 0;
+      if (!right)
+        break;
+      pos.castlingRights |= right;
+    }
+    if (n == 0)
+      return i;
+  }
+
+  // en passant target square
+  if (!expect(' '))
+    return i;
+  if (!expect('-')) {
+    char file = peek();
+    if (file < 'a' || file > 'h')
+      return i;
+    char rank = (++i, peek());
+    if (rank < '1' || rank > '8')
+      return i;
+    ++i;
+    pos.enPassant = xy2sq(file - 'a', '8' - rank);
+  }
+
+  // the board already added the piece keys
+  pos.key ^= pos.stateKey();
+
+  // incomplete FEN without clocks
+  pos.fullmoveNumber = 1;
+  if (i == fen.size())
+    return PARSE_OK;
+
+  auto readClock = [&](uint64_t limit) {
+    uint64_t value = 0;
+    while (isDigit(peek()))
+      value = std::min(value * 10 + (fen[i++] - '0'), limit);
+    return value;
+  };
+
+  if (!expect(' ') || !isDigit(peek()))
+    return i;
+  pos.halfmoveClock = readClock(UINT16_MAX);
+
+  if (!expect(' ') || !isDigit(peek()))
+    return i;
+  pos.fullmoveNumber = readClock(UINT32_MAX);
+
+  return i == fen.size() ? PARSE_OK : i;
+}
+
+// Intent: Parse a coordinate move such as "e2e4" or "e7e8Q", the promotion letter keeps its case
+// Pre: None
+// Post: Return PARSE_OK if mov is valid, otherwise the index of the first offending character
+//       (mov.size() if mov ends too early), m is unspecified in that case
+constexpr size_t readMove(std::string_view mov, CoordMove &m) {
+  for (size_t i = 0; i < 4; ++i) {
+    char c = i < mov.size() ? mov[i] : '\0';
+    if (i % 2 ? (c < '1' || c > '8') : (c < 'a' || c > 'h'))
+      return i;
+  }
+
+  m.from = xy2sq(mov[0] - 'a', '8' - mov[1]);
+  m.to = xy2sq(mov[2] - 'a', '8' - mov[3]);
+  m.promotion = NO_PIECE;
+
+  if (mov.size() == 4)
+    return PARSE_OK;
+
+  Piece p = charToPiece(mov[4]);
+  if (typeOf(p) < KNIGHT || typeOf(p) > QUEEN)
+    return 4;
+  m.promotion = p;
+
+  return mov.size() == 5 ? PARSE_OK : 5;
+}
@@ -5,10 +5,10 @@
  *         顏毓德 (B11115038@mail.ntust.edu.tw)
  *         黃雋祐 (B11115048@mail.ntust.edu.tw)
  * Create Date: May 14, 2023
- * Update Date: May 15, 2023
+ * Update Date: Oct 16, 2026
  * Description: This file contains string-based FEN processing functions
-                designed to be compiled to a stateless WASM module with
-                minimum bindings.
+                and a GameSession class that keeps a game inside the
+                module, compiled to WASM with minimum bindings.
 ****************************************************************************/
 
 #ifdef EMSCRIPTEN
@@ -17,19 +17,26 @@
 #endif
 
 #include <string>
+#include <string_view>
+#include <span>
+#include <charconv>
 #include <algorithm>
 #include <numeric>
 #include <execution>
 #include <vector>
-#include <regex>
+#include <sstream>
 
-enum FEN_DATAROW { RANK8, RANK7, RANK6, RANK5, RANK4, RANK3, RANK2, RANK1, ACTIVE_COLOR, CASTLING_RIGHTS, EN_PASSANT, HALFMOVE_CLOCK, FULLMOVE_NUMBER, BLACKKING_CRD, WHITEKING_CRD, SIZE };
-const std::regex FEN_PATTERN("^([rnbqkpRNBQKP1-8]{1,8}\\/){7}[rnbqkpRNBQKP1-8]{1,8} [wb] (-|[kqKQ]{1,4}) (-|[a-h][1-8]) \\d+ \\d+$");
-const std::regex MOVE_PATTERN("^[a-h][1-8][a-h][1-8](|[nbrqNBRQ])$");
+#include "position.h"
+#include "fen.h"
+#include "movegen.h"
+#include "search.h"
+#include "batch.h"
+#include "draw.h"
+#include "pgn.h"
+#include "book.h"
+#include "stats.h"
 
 
-struct Dir { int x; int y; };
-  
 struct Pos {
   size_t x;
   size_t y;
@@ -39,101 +46,178 @@ struct Pos {
 // Intent: Check if a coordiante is valid (coordinates from "a1" to "h8" are valid)
 // Pre: None
 // Post: None
-bool isValidCrd(const std::string &crd) {
+bool isValidCrd(std::string_view crd) {
   return crd.size() == 2 && crd[0] >= 'a' && crd[0] <= 'h' && crd[1] >= '1' && crd[1] <= '8';
 }
 
 // Intent: Convert a coordinate to Pos of x and y used for array indexing, y is inverted
 // Pre: None
 // Post: result == Pos{8, 8} if the coordinate is invalid
-Pos crd2pos(const std::string &crd) {
+Pos crd2pos(std::string_view crd) {
   return isValidCrd(crd) ? Pos{size_t(crd[0] - 'a'), size_t('8' - crd[1])} : Pos{8, 8};
 }
 
-// Intent: Convert vectors returned by parseFEN back into a FEN string
+// Intent: convert array index x and y into a string, y is inverted: (0,0) -> "a8"  (2, 3) -> "c5"  (7,7) -> "h1"
 // Pre: None
-// Post: result.size() == 0 if the input is invalid
-std::string data2fen(const std::vector<std::string> &data) {
-  if (data.size() != SIZE)
-    return "";
+// Post: result.size() == 0 if inputs are invalid
+std::string xy2crd(const size_t &x, const size_t &y) {
+  return std::max(x, y) <= 7 ? char('a' + x) + std::to_string(8 - y) : "";
+}
+
+// Longest output of writeTargets and writeMoves: 27 targets of a queen, or MAX_MOVES moves
+// of up to 5 characters, each followed by a separator
+constexpr size_t TARGETS_BUFFER_SIZE = 27 * 3;
+constexpr size_t MOVES_BUFFER_SIZE = MAX_MOVES * 6;
+
+// Intent: Write the coordinate of a square into a caller-supplied buffer, "a8" for square 0
+// Pre: sq <= 63, out has room for 2 characters
+// Post: Return the end of the written characters, nothing is allocated
+char *writeSquare(char *out, uint8_t sq) {
+  *out++ = char('a' + sq % 8);
+  return std::to_chars(out, out + 1, 8 - sq / 8).ptr;
+}
+
+// Intent: Write a move in the coordinate format accepted by getNextFEN, e.g. "e7e8Q"
+// Pre: c is the color of the moving piece, out has room for 5 characters
+// Post: Return the end of the written characters, nothing is allocated
+char *writeMove(char *out, Move m, Color c) {
+  out = writeSquare(writeSquare(out, m.from()), m.to());
+  if (m.flag() == PROMOTION)
+    *out++ = PIECE_CHARS[makePiece(c, m.promotionType())];
+  return out;
+}
+
+// Steps in the order the original generator listed the targets of each piece, which
+// getValidTargetSquares keeps ("e3" before "e4"), y grows towards rank 1 and the pawn
+// steps are white's, flipped for black
+struct TargetStep { int dx, dy; };
+constexpr TargetStep PAWN_TARGET_STEPS[] = {{1, -1}, {-1, -1}, {0, -1}, {0, -2}};
+constexpr TargetStep KNIGHT_TARGET_STEPS[] = {{-2, -1}, {-1, -2}, {1, -2}, {2, -1}, {2, 1}, {1, 2}, {-1, 2}, {-2, 1}};
+constexpr TargetStep QUEEN_TARGET_STEPS[] = {{1, 1}, {1, -1}, {-1, 1}, {-1, -1}, {1, 0}, {0, 1}, {-1, 0}, {0, -1}};
+constexpr TargetStep KING_TARGET_STEPS[] = {{1, 0}, {1, 1}, {0, 1}, {-1, 1}, {-1, 0}, {-1, -1}, {0, -1}, {1, -1}, {2, 0}, {-2, 0}};
+
+// Intent: Write the '\0'-separated targets of the legal moves from a square
+// Pre: out has room for TARGETS_BUFFER_SIZE characters
+// Post: Return the number of characters written, without a trailing '\0', the targets are
+//       in the order of the TARGET_STEPS tables, sliders walk each ray outwards
+size_t writeTargets(const Position &pos, uint8_t from, char *out) {
+  Bitboard targets = legalTargets(pos, from);
+  char *end = out;
+  auto write = [&](uint8_t sq) {
+    end = writeSquare(end, sq);
+    *end++ = '\0';
+    targets &= ~bit(sq);
+  };
   
+  PieceType type = typeOf(pos.board[from]);
+  std::span<const TargetStep> steps = type == PAWN ? std::span<const TargetStep>(PAWN_TARGET_STEPS)
+                                    : type == KNIGHT ? std::span<const TargetStep>(KNIGHT_TARGET_STEPS)
+                                    : type == BISHOP ? std::span(QUEEN_TARGET_STEPS).first(4)
+                                    : type == ROOK ? std::span(QUEEN_TARGET_STEPS).last(4)
+                                    : type == QUEEN ? std::span<const TargetStep>(QUEEN_TARGET_STEPS)
+                                    : std::span<const TargetStep>(KING_TARGET_STEPS);
+  bool slides = type == BISHOP || type == ROOK || type == QUEEN;
+  int flip = type == PAWN && colorOf(pos.board[from]) == BLACK ? -1 : 1;
+  
+  for (size_t i = 0; targets && i < steps.size(); ++i) {
+    int x = from % 8, y = from / 8;
+    while (true) {
+      x += steps[i].dx;
+      y += steps[i].dy * flip;
+      if (std::min(x, y) < 0 || std::max(x, y) > 7)
+        break;
+      uint8_t sq = xy2sq(x, y);
+      if (targets & bit(sq))
+        write(sq);
+      if (!slides || pos.board[sq] != NO_PIECE)
+        break;
+    }
+  }
+  return end == out ? 0 : size_t(end - out - 1);
+}
+
+// Intent: Write the '\0'-separated moves of a list
+// Pre: c is the side to move, out has room for MOVES_BUFFER_SIZE characters
+// Post: Return the number of characters written, without a trailing '\0'
+size_t writeMoves(const MoveList &moves, Color c, char *out) {
+  char *end = out;
+  for (const Move &m : moves) {
+    end = writeMove(end, m, c);
+    *end++ = '\0';
+  }
+  return end == out ? 0 : size_t(end - out - 1);
+}
+
+// Intent: Convert a Position back into a FEN string
+// Pre: pos was filled by parseFEN
+// Post: None
+std::string data2fen(const Position &pos) {
   std::string result;
   
-  for (size_t y = RANK8; y <= RANK1; ++y) {
+  for (size_t y = 0; y < 8; ++y) {
     size_t spaces = 0;
-    for (const char &c : data[y]) {
-      if (c == ' ') {
+    for (size_t x = 0; x < 8; ++x) {
+      if (pos.at(x, y) == NO_PIECE) {
         ++spaces;
       } else {
         if (spaces) {
-          result += std::to_string(spaces);
+          result += char('0' + spaces);
           spaces = 0;
         }
-        result += c;
+        result += PIECE_CHARS[pos.at(x, y)];
       }
     }
     if (spaces)
-      result += std::to_string(spaces);
+      result += char('0' + spaces);
     result += '/';
   }
   result.back() = ' ';
   
-  result += data[ACTIVE_COLOR] + ' ' + data[CASTLING_RIGHTS] + ' ' + data[EN_PASSANT]
-         + ' ' + data[HALFMOVE_CLOCK] + ' ' + data[FULLMOVE_NUMBER];
+  result += pos.activeColor == WHITE ? 'w' : 'b';
+  result += ' ';
   
-  return result;
-}
-
-// Intent: Increment a numeric string by 1
-// Pre: None
-// Post: result.size() == 0 if inputs are invalid
-std::string incrementStr(const std::string &str) {
-  try {
-    return std::to_string(std::stoi(str) + 1);
-  } catch (...) { // std::invalid_argument and std::out_of_range
-    return "";
+  if (pos.castlingRights) {
+    for (auto [right, c] : {std::pair{WHITE_OO, 'K'}, {WHITE_OOO, 'Q'}, {BLACK_OO, 'k'}, {BLACK_OOO, 'q'}})
+      if (pos.castlingRights & right)
+        result += c;
+  } else {
+    result += '-';
   }
+  
+  result += ' ' + (pos.enPassant == NO_SQUARE ? "-" : xy2crd(pos.enPassant % 8, pos.enPassant / 8))
+         + ' ' + std::to_string(pos.halfmoveClock) + ' ' + std::to_string(pos.fullmoveNumber);
+  
+  return result;
 }
 
-// Intent: convert array index x and y into a string, y is inverted: (0,0) -> "a8"  (2, 3) -> "c5"  (7,7) -> "h1"
+// Intent: Parse FEN string into pos
 // Pre: None
-// Post: result.size() == 0 if inputs are invalid
-std::string xy2crd(const size_t &x, const size_t &y) {
-  return std::max(x, y) <= 7 ? char('a' + x) + std::to_string(8 - y) : "";
+// Post: Return false if the input is invalid, pos is unspecified in that case
+bool parseFEN(const std::string &fen, Position &pos) {
+  return readFEN(fen, pos) == PARSE_OK;
 }
 
-// Intent: Parse FEN string
-// Pre: None
-// Post: result.size() == 0 if the input is invalid
-std::vector<std::string> parseFEN(const std::string &fen) {
-  // check the string format
-  if (!std::regex_match(fen, FEN_PATTERN))
-    return {};
+// Intent: Turn a coordinate move into a Move by looking at the pieces it touches
+// Pre: pos.board[m.from] belongs to the side to move
+// Post: The move is not checked against the rules, a king moving two files from its initial
+//       square next to its own rook castles and a pawn moving onto the en passant square captures en passant
+Move coord2move(const Position &pos, const CoordMove &m) {
+  Color us = pos.activeColor;
+  PieceType type = typeOf(pos.board[m.from]);
   
-  std::vector<std::string> result(SIZE);
-  auto it = fen.begin();
+  if (m.promotion)
+    return encodeMove(m.from, m.to, PROMOTION, typeOf(m.promotion));
   
-  // parse the data
-  for (size_t y = RANK8; it != fen.end(); ++it) {
-    if (*it == '/' || *it == ' ') { // split the string
-      // check if each row in chess board is exactly 8 chars long
-      if (y <= RANK1 && result[y].size() != 8)
-        return {};
-      ++y;
-    } else if (y <= RANK1 && isdigit(*it)) { // add spaces to chess board
-      result[y] += std::string(*it - '0', ' ');
-    } else { // add char to datarows
-      if (y <= RANK1 && tolower(*it) == 'k')
-        result[islower(*it) ? BLACKKING_CRD : WHITEKING_CRD] += xy2crd(result[y].size(), y);
-      result[y] += *it;
-    }
+  if (type == KING && (m.to == m.from + 2 || m.to + 2 == m.from)) {
+    const CastlingPath &path = CASTLING_PATHS[us][m.to < m.from];
+    if (m.from == path.kingFrom && m.to == path.kingTo && pos.board[path.rookFrom] == makePiece(us, ROOK))
+      return encodeMove(m.from, m.to, CASTLING);
   }
   
-  // check if each side has exactly 1 king
-  if (result[BLACKKING_CRD].size() != 2 || result[WHITEKING_CRD].size() != 2)
-    return {};
+  if (type == PAWN && m.to == pos.enPassant && m.from % 8 != m.to % 8 && pos.board[enPassantVictim(pos)])
+    return encodeMove(m.from, m.to, EN_PASSANT);
   
-  return result;
+  return encodeMove(m.from, m.to);
 }
 
 // Intent: Get the FEN after making a move, the move formatted as such:
@@ -142,113 +226,55 @@ std::vector<std::string> parseFEN(const std::string &fen) {
 //           "e5f6"   : e5 to f6 (or en passant)
 //           "e1g1"   : e1 to g1 (or castle kingside)
 // Pre: Make sure the move is legal, as this function ignores most chess rules
-// Post: result.size() == 0 if the FEN is invalid or if the move is out of bounds
+// Post: result.size() == 0 if the FEN is invalid, if the move is out of bounds or if it does
+//       not start from a piece of the side to move
 std::string getNextFEN(const std::string &fen, const std::string &mov) {
+  STAT_FUNCTION(FN_GET_NEXT_FEN);
   // invalid move format
-  if (!std::regex_match(mov, MOVE_PATTERN))
+  CoordMove m;
+  if (readMove(mov, m) != PARSE_OK)
     return "";
   
   // invalid FEN
-  auto data = parseFEN(fen);
-  if (data.size() != SIZE)
+  Position pos;
+  if (!parseFEN(fen, pos))
     return "";
   
-  auto [sx, sy] = crd2pos(mov.substr(0, 2));
-  auto [tx, ty] = crd2pos(mov.substr(2, 2));
-  int dx = int(tx) - int(sx);
-  int dy = int(ty) - int(sy);
-  char &sp = data[sy][sx];
-  char &tp = data[ty][tx];
-  char promotion = mov.size() == 5 ? mov.back() : 0;
-  
-  // castling
-  if (tolower(sp) == 'k') {
-    if (dx == 2) // castle kingside
-      std::swap(data[sy][7], data[sy][sx + 1]);
-    else if (dx == -2) // castle queenside
-      std::swap(data[sy][0], data[sy][sx - 1]);
-  }
-  
-  // en passant
-  if (tolower(sp) == 'p' && Pos{tx, ty} == crd2pos(data[EN_PASSANT]))
-    data[sy][tx] = ' ';
-  
-  auto removeCastlingRights = [&castling = data[CASTLING_RIGHTS]](const std::string &rem) {
-    for (char c : rem) {
-      auto pos = castling.find(c);
-      if (pos != std::string::npos)
-        castling.erase(pos, 1);
-    }
-    if (castling.size() == 0)
-      castling = "-";
-  };
-  
-  // remove castling rights
-  if (sp == 'r' || tp == 'r')
-    removeCastlingRights(tx == 7 ? "k" : "q");
-  else if (sp == 'R' || tp == 'R')
-    removeCastlingRights(tx == 7 ? "K" : "Q");
-  if (sp == 'k')
-    removeCastlingRights("kq");
-  else if (sp == 'K')
-    removeCastlingRights("KQ");
-  
-  // update en passant target square
-  data[EN_PASSANT] = (tolower(sp) == 'p' && abs(dy) == 2) ? xy2crd(sx, sy + dy / 2) : "-";
-  
-  // reset or increment the halfmove clock
-  data[HALFMOVE_CLOCK] = (tolower(sp) == 'p' || tp != ' ') ? "0" : incrementStr(data[HALFMOVE_CLOCK]);
-  
-  // increment the fullmove counter and switch active color
-  if (data[ACTIVE_COLOR] == "b") {
-    data[FULLMOVE_NUMBER] = incrementStr(data[FULLMOVE_NUMBER]);
-    data[ACTIVE_COLOR] = 'w';
-  } else {
-    data[ACTIVE_COLOR] = 'b';
-  }
-  
-  // move and promote the piece
-  tp = promotion ? promotion : sp;
-  sp = ' ';
+  // only the side to move can move
+  if (pos.board[m.from] == NO_PIECE || colorOf(pos.board[m.from]) != pos.activeColor)
+    return "";
   
-  return data2fen(data);
+  makeMove(pos, coord2move(pos, m));
+  return data2fen(pos);
 }
 
+// Html class names of each piece code, indexed by Piece
+constexpr const char *PIECE_CLASS_NAMES[] = {
+  "empty-square",
+  "piece white-pawn", "piece white-knight", "piece white-bishop", "piece white-rook", "piece white-queen", "piece white-king",
+  "", "",
+  "piece black-pawn", "piece black-knight", "piece black-bishop", "piece black-rook", "piece black-queen", "piece black-king",
+};
+
 // Intent: Convert FEN to '\0'-seperated string of html class names
 // Pre: None
 // Post: None
 std::string fenToHtmlClassNames(const std::string &fen) {
-  std::string pieces = "";
-  auto data = parseFEN(fen);
+  STAT_FUNCTION(FN_FEN_TO_HTML_CLASS_NAMES);
+  Position pos;
   
   // invalid FEN
-  if (data.size() != SIZE)
+  if (!parseFEN(fen, pos))
     return "";
   
-  // concatenate chess board to a string
-  pieces = std::accumulate(data.begin(), data.begin() + 8, std::string{});
-  
-  // replace each piece with its html class name + ' '
-  std::unordered_map<char, std::string> classNames{
-    {' ', "empty-square"},
-    {'k', "piece black-king"},
-    {'p', "piece black-pawn"},
-    {'n', "piece black-knight"},
-    {'b', "piece black-bishop"},
-    {'r', "piece black-rook"},
-    {'q', "piece black-queen"},
-    {'K', "piece white-king"},
-    {'P', "piece white-pawn"},
-    {'N', "piece white-knight"},
-    {'B', "piece white-bishop"},
-    {'R', "piece white-rook"},
-    {'Q', "piece white-queen"},
-  };
-  
-  std::string result = "";
+  // the longest name is 18 characters plus its separator
+  std::string result;
+  result.reserve(64 * 19);
   
-  for (const char &p : pieces)
-    result += classNames[p] + '\0';
+  for (const Piece &p : pos.board) {
+    result += PIECE_CLASS_NAMES[p];
+    result += '\0';
+  }
   result.pop_back();
   return result;
 }
@@ -257,7 +283,7 @@ std::string fenToHtmlClassNames(const std::string &fen) {
 // Pre: None
 // Post: The return value is a '\0'-seperated string of valid target squares
 std::string getValidTargetSquares(const std::string &fen, const std::string &src, const bool showWhoIsInCheck = false) {
-  std::vector<Pos> targetSquares;
+  STAT_FUNCTION(FN_GET_VALID_TARGET_SQUARES);
   auto [sx, sy] = crd2pos(src);
   
   // invalid coordinate
@@ -265,269 +291,2181 @@ std::string getValidTargetSquares(const std::string &fen, const std::string &src
     return "";
   
   // invalid FEN
-  auto data = parseFEN(fen);
-  if (data.size() != SIZE)
+  Position pos;
+  if (!parseFEN(fen, pos))
     return "";
   
-  auto [kx, ky] = crd2pos(data[ACTIVE_COLOR] == "w" ? data[WHITEKING_CRD] : data[BLACKKING_CRD]);
+  // Moving enemy pieces or empty squares is not allowed, legalTargets returns nothing for them.
+  // The squares are written into a stack buffer and copied into the result once.
+  char buffer[TARGETS_BUFFER_SIZE];
+  size_t size = writeTargets(pos, xy2sq(sx, sy), buffer);
+  if (!size && showWhoIsInCheck && pos.inCheck())
+    return pos.activeColor == WHITE ? "White is in check" : "Black is in check";
   
-  auto isBlocked = [&data](const size_t &x, const size_t &y) {
-    return std::max(x, y) > 7 || (data[ACTIVE_COLOR] == "w" ? isupper(data[y][x]) : islower(data[y][x]));
-  };
+  return std::string(buffer, size);
+}
+
+// Intent: Convert a Move into the coordinate format accepted by getNextFEN
+// Pre: c is the color of the moving piece
+// Post: None
+std::string move2crd(const Move &m, Color c) {
+  char buffer[5];
+  return std::string(buffer, writeMove(buffer, m, c));
+}
+
+// Intent: Get every legal move of the side to move
+// Pre: None
+// Post: The return value is a '\0'-seperated string of moves formatted like getNextFEN's input,
+//       result.size() == 0 if the FEN is invalid or if there is no legal move
+std::string getLegalMoves(const std::string &fen) {
+  STAT_FUNCTION(FN_GET_LEGAL_MOVES);
+  Position pos;
+  if (!parseFEN(fen, pos))
+    return "";
   
-  auto addMove = [&](const size_t &x, const size_t &y) {
-    targetSquares.push_back({x, y});
-  };
+  MoveList moves;
+  generateLegalMoves(pos, moves);
   
-  auto addMoves = [&](const Dir &dir) {
-    auto [dirX, dirY] = dir;
-    size_t x = sx, y = sy;
-    while (!isBlocked(x += dirX, y += dirY)) {
-      addMove(x, y);
-      if (data[y][x] != ' ')
-        break;
-    }
-  };
+  char buffer[MOVES_BUFFER_SIZE];
+  return std::string(buffer, writeMoves(moves, pos.activeColor, buffer));
+}
+
+// Intent: Check if a move is valid, the promotion letter is not checked
+// Pre: None
+// Post: None
+bool isValidMove(const std::string &fen, const std::string &move) {
+  STAT_FUNCTION(FN_IS_VALID_MOVE);
+  CoordMove m;
+  Position pos;
+  if (readMove(move, m) != PARSE_OK || !parseFEN(fen, pos))
+    return false;
   
-  auto isAttackedByEnemy = [&](const size_t &x, const size_t &y) {
-    auto isAttackedFromBy = [&](int dirX, int dirY, const std::string &attackers, size_t range = 7) {
-      size_t curX = x, curY = y;
-      while (range-- && !isBlocked(curX += dirX, curY += dirY)) {
-        if (attackers.find(data[curY][curX]) != std::string::npos)
-          return true;
-        if (data[curY][curX] != ' ')
-          break;
-      }
-      return false;
-    };
-    return isAttackedFromBy(1, 1, "bqBQ") || isAttackedFromBy(1, -1, "bqBQ") || isAttackedFromBy(-1, -1, "bqBQ") || isAttackedFromBy(-1, 1, "bqBQ") ||
-           isAttackedFromBy(1, 0, "rqRQ") || isAttackedFromBy(0, 1, "rqRQ") || isAttackedFromBy(-1, 0, "rqRQ") || isAttackedFromBy(0, -1, "rqRQ") ||
-           isAttackedFromBy(-2, -1, "nN", 1) || isAttackedFromBy(-1, -2, "nN", 1) || isAttackedFromBy(1, -2, "nN", 1) || isAttackedFromBy(2, -1, "nN", 1) ||
-           isAttackedFromBy(2, 1, "nN", 1) || isAttackedFromBy(1, 2, "nN", 1) || isAttackedFromBy(-1, 2, "nN", 1) || isAttackedFromBy(-2, 1, "nN", 1) ||
-           isAttackedFromBy(1, 1, "pkPK", 1) || isAttackedFromBy(-1, 1, "pkPK", 1) || isAttackedFromBy(1, -1, "pkpK", 1) || isAttackedFromBy(-1, -1, "pkpK", 1) ||
-           isAttackedFromBy(1, 0, "kK", 1) || isAttackedFromBy(0, 1, "kK", 1) || isAttackedFromBy(-1, 0, "kK", 1) || isAttackedFromBy(0, -1, "kK", 1)
-           ;
-  };
+  MoveList moves;
+  generateLegalMoves(pos, moves);
   
-  // Moving enemy pieces or empty squares is not allowed
-  if (!isBlocked(sx, sy)) {
-    std::string result;
-    if (showWhoIsInCheck && isAttackedByEnemy(kx, ky)) {
-      result = data[ACTIVE_COLOR] == "w" ? "White" : "Black";
-      result += " is in check";
-    }
-    return result;
+  return std::any_of(moves.begin(), moves.end(), [&m](const Move &legal) {
+    return legal.from() == m.from && legal.to() == m.to;
+  });
+}
+
+// Intent: Describe the state of pos, see getGameState for the strings
+// Pre: history is nullptr or holds the positions played before pos
+// Post: Checkmate and stalemate come before the draw rules
+std::string describeState(const Position &pos, const KeyHistory *history) {
+  if (!hasAnyLegalMove(pos)) {
+    if (pos.inCheck())
+      return pos.activeColor == WHITE ? "Checkmate: Black wins" : "Checkmate: White wins";
+    return "Stalemate: Draw";
   }
   
-  // generate pseudo-legal moves
-  char sp = data[sy][sx];
-  char sptype = tolower(sp);
+  switch (drawReason(pos, history)) {
+    case DRAW_INSUFFICIENT_MATERIAL: return "Insufficient material: Draw";
+    case DRAW_FIFTY_MOVES: return "Fifty-move rule: Draw";
+    case DRAW_REPETITION: return "Threefold repetition: Draw";
+    default: return pos.activeColor == WHITE ? "White to move" : "Black to move";
+  }
+}
+
+// Intent: Get the game state, which is one of the following:
+//           1. "White to move"
+//           2. "Black to move"
+//           3. "Checkmate: White wins"
+//           4. "Checkmate: Black wins"
+//           5. "Stalemate: Draw"
+//           6. "Insufficient material: Draw"
+//           7. "Fifty-move rule: Draw"
+//           8. "Invalid FEN"
+// Pre: None
+// Post: Repetitions need the moves of the game, see getGameStateAfterMoves
+std::string getGameState(const std::string &fen) {
+  STAT_FUNCTION(FN_GET_GAME_STATE);
+  Position pos;
+  if (!parseFEN(fen, pos))
+    return "Invalid FEN";
   
-  auto isEmpty = [&](size_t x, size_t y) {
-    return !isBlocked(x, y) && data[y][x] == ' ';
-  };
+  return describeState(pos, nullptr);
+}
+
+// Intent: Get the game state after playing space-separated moves formatted like getNextFEN's input
+//         from fen, which adds "Threefold repetition: Draw" and "Invalid move" to getGameState's states
+// Pre: None
+// Post: Each move is checked against the legal moves, repetitions are found by comparing
+//       Zobrist keys within the halfmove clock instead of FEN strings
+std::string getGameStateAfterMoves(const std::string &fen, const std::string &moves) {
+  STAT_FUNCTION(FN_GET_GAME_STATE_AFTER_MOVES);
+  Position pos;
+  if (!parseFEN(fen, pos))
+    return "Invalid FEN";
   
-  if (sptype == 'k') {
-    for (auto [x, y] : {Pos{sx + 1, sy}, {sx + 1, sy + 1}, {sx, sy + 1}, {sx - 1, sy + 1}, {sx - 1, sy}, {sx - 1, sy - 1}, {sx, sy - 1}, {sx + 1, sy - 1}})
-      if (!isBlocked(x, y))
-        addMove(x, y);
-    
-    if (data[CASTLING_RIGHTS].find(islower(sp) ? 'k' : 'K') != std::string::npos && isEmpty(sx + 1, sy) && isEmpty(sx + 2, sy)
-      && !isAttackedByEnemy(sx, sy) && !isAttackedByEnemy(sx + 1, sy) && !isAttackedByEnemy(sx + 2, sy))
-    {
-      addMove(sx + 2, sy);
-    }
-    
-    if (data[CASTLING_RIGHTS].find(islower(sp) ? 'q' : 'Q') != std::string::npos && isEmpty(sx - 1, sy) && isEmpty(sx - 2, sy) && isEmpty(sx - 3, sy)
-      && !isAttackedByEnemy(sx, sy) && !isAttackedByEnemy(sx - 1, sy) && !isAttackedByEnemy(sx - 2, sy))
-    {
-      addMove(sx - 2, sy);
-    }
-  }
-  else if (sp == 'p') {  
-    auto ePos = crd2pos(data[EN_PASSANT]);
-    
-    if (!isBlocked(sx + 1, sy + 1) && data[sy + 1][sx + 1] != ' ' || Pos{sx + 1, sy + 1} == ePos)
-      addMove(sx + 1, sy + 1);
-    
-    if (!isBlocked(sx - 1, sy + 1) && data[sy + 1][sx - 1] != ' ' || Pos{sx - 1, sy + 1} == ePos)
-      addMove(sx - 1, sy + 1);
-    
-    if (!isBlocked(sx, sy + 1) && data[sy + 1][sx] == ' ') {
-      addMove(sx, sy + 1);
-      if (sy == 1 && !isBlocked(sx, sy + 2) && data[sy + 2][sx] == ' ') {
-        addMove(sx, sy + 2);
-      }
-    }
-  }
-  else if (sp == 'P') {
-    auto ePos = crd2pos(data[EN_PASSANT]);
-    
-    if (!isBlocked(sx + 1, sy - 1) && data[sy - 1][sx + 1] != ' ' || Pos{sx + 1, sy - 1} == ePos)
-      addMove(sx + 1, sy - 1);
-    
-    if (!isBlocked(sx - 1, sy - 1) && data[sy - 1][sx - 1] != ' ' || Pos{sx - 1, sy - 1} == ePos)
-      addMove(sx - 1, sy - 1);
-    
-    if (!isBlocked(sx, sy - 1) && data[sy - 1][sx] == ' ') {
-      addMove(sx, sy - 1);
-      if (sy == 6 && !isBlocked(sx, sy - 2) && data[sy - 2][sx] == ' ') {
-        addMove(sx, sy - 2);
-      }
-    }
-  }
-  else if (sptype == 'n') {
-    for (auto [x, y] : {Pos{sx - 2, sy - 1}, {sx - 1, sy - 2}, {sx + 1, sy - 2}, {sx + 2, sy - 1}, {sx + 2, sy + 1}, {sx + 1, sy + 2}, {sx - 1, sy + 2}, {sx - 2, sy + 1}}) {
-      if (!isBlocked(x, y))
-        addMove(x, y);
-    }
-  }
-  else if (sptype == 'b') {
-    for (auto dir : {Dir{1, 1}, {1, -1}, {-1, 1}, {-1, -1}})
-      addMoves(dir);
-  }
-  else if (sptype == 'r') {
-    for (auto dir : {Dir{1, 0}, {0, 1}, {-1, 0}, {0, -1}})
-      addMoves(dir);
-  }
-  else if (sptype == 'q') {
-    for (auto dir : {Dir{1, 1}, {1, -1}, {-1, 1}, {-1, -1}, {1, 0}, {0, 1}, {-1, 0}, {0, -1}})
-      addMoves(dir);
+  KeyHistory history;
+  std::istringstream in(moves);
+  for (std::string mov; in >> mov; ) {
+    CoordMove m;
+    MoveList legal;
+    generateLegalMoves(pos, legal);
+    if (readMove(mov, m) != PARSE_OK || pos.board[m.from] == NO_PIECE || colorOf(pos.board[m.from]) != pos.activeColor)
+      return "Invalid move";
+    Move played = coord2move(pos, m);
+    if (std::find(legal.begin(), legal.end(), played) == legal.end())
+      return "Invalid move";
+    history.push(pos);
+    makeMove(pos, played);
   }
   
-  // filter illegal moves that leave the king in check & form the result string
-  std::string result = "";
+  return describeState(pos, &history);
+}
+
+// Intent: Get the 64-bit Zobrist hash of a position, positions that differ only in their clocks share it
+// Pre: None
+// Post: The return value is 16 lowercase hex digits, result.size() == 0 if the FEN is invalid
+std::string getPositionKey(const std::string &fen) {
+  STAT_FUNCTION(FN_GET_POSITION_KEY);
+  Position pos;
+  if (!parseFEN(fen, pos))
+    return "";
   
-  for (const Pos &p : targetSquares) {
-    auto [tx, ty] = p;
-    char tp = data[ty][tx];
-    
-    // move the piece
-    data[sy][sx] = ' ';
-    data[ty][tx] = sp;
-    
-    // check if king is attacked after moving
-    if ((sptype == 'k') ? (!isAttackedByEnemy(tx, ty)) : (!isAttackedByEnemy(kx, ky)))
-      result += xy2crd(tx, ty) + '\0';
-    
-    // undo the move
-    data[sy][sx] = sp;
-    data[ty][tx] = tp;
+  std::string result(16, '0');
+  for (size_t i = 0; i < 16; ++i)
+    result[15 - i] = "0123456789abcdef"[(pos.key >> (4 * i)) & 15];
+  return result;
+}
+
+// Intent: Parse search limits written like "depth 6", "movetime 200" or "nodes 100000 depth 8 threads 4"
+// Pre: None
+// Post: Return false if the string has an unknown word or a missing number,
+//       only depth 4 is set if the string sets no limit
+bool parseLimits(const std::string &str, SearchLimits &limits) {
+  std::istringstream in(str);
+  std::string name;
+  uint64_t value;
+  limits = {};
+  while (in >> name) {
+    if (!(in >> value))
+      return false;
+    if (name == "depth")
+      limits.depth = unsigned(value);
+    else if (name == "nodes")
+      limits.nodes = value;
+    else if (name == "movetime")
+      limits.milliseconds = unsigned(value);
+    else if (name == "threads")
+      limits.threads = std::max(unsigned(value), 1u);
+    else
+      return false;
   }
+  if (!limits.depth && !limits.nodes && !limits.milliseconds)
+    limits.depth = 4;
+  return true;
+}
+
+// The opening book asked by getBestMove and getBookMove, nullptr until loadBook succeeds
+std::unique_ptr<Book> openingBook;
+
+// Seed of the weighted random book moves
+uint64_t bookRandom = 0xB00C'5EEDull;
+
+// Intent: Replace the opening book by the bytes of a Polyglot .bin file, JavaScript passes
+//         the fetched file as a Uint8Array that is copied into the heap once
+// Pre: None
+// Post: Return false and keep the old book if the size is not a multiple of 16 bytes
+bool loadBook(const std::string &bytes) {
+  STAT_FUNCTION(FN_LOAD_BOOK);
+  return Book::fromBytes(bytes, openingBook) == BOOK_OK;
+}
+
+// Intent: Get the book moves of a position
+// Pre: None
+// Post: The return value is a '\0'-seperated string of moves formatted like getNextFEN's input,
+//       in book order, result.size() == 0 if the FEN is invalid or if the position is not in the book
+std::string getBookMoves(const std::string &fen) {
+  STAT_FUNCTION(FN_GET_BOOK_MOVES);
+  Position pos;
+  if (!openingBook || !parseFEN(fen, pos))
+    return "";
+  
+  MoveList moves;
+  generateLegalMoves(pos, moves);
+  BookMoves found;
+  openingBook->probe(pos, moves, found);
   
-  // remove trailing '\0' character
-  if (result.size()) {
+  std::string result = "";
+  for (const BookMove &m : found)
+    result += move2crd(m.move, pos.activeColor) + '\0';
+  if (result.size())
     result.pop_back();
-  } else if (showWhoIsInCheck && isAttackedByEnemy(kx, ky)) {
-    result = data[ACTIVE_COLOR] == "w" ? "White" : "Black";
-    result += " is in check";
+  return result;
+}
+
+// Intent: Choose a book move, mode is "best" for the heaviest move or "random" to pick
+//         at random in proportion to the weights
+// Pre: None
+// Post: The return value is formatted like getNextFEN's input, result.size() == 0 if the FEN
+//       or the mode is invalid or if the position is not in the book
+std::string getBookMove(const std::string &fen, const std::string &mode) {
+  STAT_FUNCTION(FN_GET_BOOK_MOVE);
+  Position pos;
+  if (!openingBook || (mode != "best" && mode != "random") || !parseFEN(fen, pos))
+    return "";
+  
+  MoveList moves;
+  generateLegalMoves(pos, moves);
+  Move m;
+  if (!openingBook->pick(pos, moves, mode == "best" ? BOOK_BEST : BOOK_WEIGHTED, bookRandom, m))
+    return "";
+  return move2crd(m, pos.activeColor);
+}
+
+// Endgame tables probed by getBestMove and getTablebaseState, filled by generateTablebases
+Tablebase endgames;
+
+// Intent: Generate space-separated tables such as "KQvK KRvK KBNvK" and the tables they need
+// Pre: None
+// Post: Return false at the first unsupported name, the tables generated before it are kept
+bool generateTablebases(const std::string &names) {
+  STAT_FUNCTION(FN_GENERATE_TABLEBASES);
+#if defined(EMSCRIPTEN) && !defined(__EMSCRIPTEN_PTHREADS__)
+  WorkerPool pool(1);
+#else
+  WorkerPool pool(std::max(std::thread::hardware_concurrency(), 1u));
+#endif
+  std::istringstream in(names);
+  for (std::string name; in >> name; )
+    if (endgames.generate(name, pool) != TB_OK)
+      return false;
+  return true;
+}
+
+// Intent: Get the tablebase verdict of a position: "White mates in 3", "Black mates in 1",
+//         "Draw" or "" if the FEN is invalid or no generated table holds the position
+// Pre: None
+// Post: The count is in moves of the winner, the fifty-move rule is not taken into account
+std::string getTablebaseState(const std::string &fen) {
+  STAT_FUNCTION(FN_GET_TABLEBASE_STATE);
+  Position pos;
+  TbResult result;
+  if (!parseFEN(fen, pos) || !endgames.probe(pos, result))
+    return "";
+  if (result.wdl == TB_DRAW)
+    return "Draw";
+  Color winner = result.wdl == TB_WIN ? pos.activeColor : Color(!pos.activeColor);
+  return std::string(winner == WHITE ? "White" : "Black") + " mates in " + std::to_string((result.dtm + 1) / 2);
+}
+
+// Intent: Search for the best move of the side to move, the table is kept between calls.
+//         In the first BOOK_PLIES plies of a game a book move is returned without searching,
+//         positions of the generated endgame tables are scored by their distance to mate.
+// Pre: None
+// Post: The return value is formatted like getNextFEN's input, result.size() == 0 if the FEN
+//       or the limits are invalid or if there is no legal move
+std::string getBestMove(const std::string &fen, const std::string &limitsStr) {
+  STAT_FUNCTION(FN_GET_BEST_MOVE);
+  static TranspositionTable tt(4);
+  
+  Position pos;
+  SearchLimits limits;
+  if (!parseFEN(fen, pos) || !parseLimits(limitsStr, limits))
+    return "";
+  
+  if (openingBook && (pos.fullmoveNumber - 1) * 2 + pos.activeColor < BOOK_PLIES) {
+    MoveList moves;
+    generateLegalMoves(pos, moves);
+    Move m;
+    if (openingBook->pick(pos, moves, BOOK_WEIGHTED, bookRandom, m))
+      return move2crd(m, pos.activeColor);
   }
   
-  return result;
+  SearchResult result = search(pos, limits, tt, nullptr, &endgames);
+  STAT_ADD(STAT_TT_HITS, result.tt.hits);
+  STAT_ADD(STAT_TT_MISSES, result.tt.misses);
+  STAT_ADD(STAT_TT_STORES, result.tt.stores);
+  STAT_ADD(STAT_TT_COLLISIONS, result.tt.collisions);
+  return result.depth ? move2crd(result.bestMove, pos.activeColor) : "";
 }
 
-// Intent: Check if a move is valid
+// Intent: Convert a SAN move such as "Nf3", "exd6" or "O-O" into the format of getNextFEN's input
 // Pre: None
-// Post: None
-bool isValidMove(const std::string &fen, const std::string &move) {
-  if (!std::regex_match(move, MOVE_PATTERN))
-    return false;
+// Post: result.size() == 0 if the FEN is invalid or if the SAN is not exactly one legal move
+std::string sanToMove(const std::string &fen, const std::string &san) {
+  STAT_FUNCTION(FN_SAN_TO_MOVE);
+  Position pos;
+  if (!parseFEN(fen, pos))
+    return "";
   
-  std::string source = move.substr(0, 2);
-  std::string validSquares = getValidTargetSquares(fen, source);
-  std::string target = move.substr(2, 2);
+  MoveList moves;
+  generateLegalMoves(pos, moves);
+  Move m;
+  return decodeSAN(pos, moves, san, m) == PGN_OK ? move2crd(m, pos.activeColor) : "";
+}
+
+// Intent: Get the static exchange evaluation of a move formatted like getNextFEN's input: the
+//         centipawns the mover wins if both sides keep recapturing on the target square while it pays
+// Pre: None
+// Post: The return value is a decimal number such as "100" or "-220", result.size() == 0 if the
+//       FEN is invalid or the move is not legal
+std::string getStaticExchange(const std::string &fen, const std::string &mov) {
+  STAT_FUNCTION(FN_GET_STATIC_EXCHANGE);
+  CoordMove m;
+  Position pos;
+  if (readMove(mov, m) != PARSE_OK || !parseFEN(fen, pos) || pos.board[m.from] == NO_PIECE
+      || colorOf(pos.board[m.from]) != pos.activeColor)
+    return "";
   
-  return validSquares.find(target) != std::string::npos;
+  MoveList moves;
+  generateLegalMoves(pos, moves);
+  Move played = coord2move(pos, m);
+  if (std::find(moves.begin(), moves.end(), played) == moves.end())
+    return "";
+  return std::to_string(see(pos, played));
 }
 
-// Intent: Get the game state, which is one of the following:
-//           1. "White to move"
-//           2. "Black to move"
-//           3. "Checkmate: White wins"
-//           4. "Checkmate: Black wins"
-//           5. "Stalemate: Draw"
-//           6. "Invalid FEN"
+// Intent: Get the pieces of both colors that the other side wins material by taking, kings aside
 // Pre: None
-// Post: None
-std::string getGameState(const std::string &fen) {
-  auto data = parseFEN(fen);
-  if (data.size() != SIZE)
-    return "Invalid FEN";
+// Post: The return value is a '\0'-seperated string of squares like getValidTargetSquares',
+//       result.size() == 0 if the FEN is invalid or nothing is hanging
+std::string getHangingPieces(const std::string &fen) {
+  STAT_FUNCTION(FN_GET_HANGING_PIECES);
+  Position pos;
+  if (!parseFEN(fen, pos))
+    return "";
   
-  for (size_t y = 0; y < 8; ++y) {
-    for (size_t x = 0; x < 8; ++x) {
-      if (getValidTargetSquares(fen, xy2crd(x, y)).size()) {
-        return data[ACTIVE_COLOR] == "w" ? "White to move" : "Black to move";
-      }
-    }
+  // at most 30 pieces besides the kings, 3 characters each
+  char buffer[30 * 3];
+  char *out = buffer;
+  for (Bitboard hanging = hangingPieces(pos, WHITE) | hangingPieces(pos, BLACK); hanging; ) {
+    out = writeSquare(out, popLsb(hanging));
+    *out++ = '\0';
+  }
+  return std::string(buffer, out == buffer ? 0 : out - buffer - 1);
+}
+
+// Intent: Analyze many '\n'-separated FEN or EPD lines in one call, see analyzeLine for the output format
+// Pre: None
+// Post: The return value has one '\n'-terminated line per non-blank input line, in input order
+std::string analyzePositions(const std::string &lines, unsigned depth) {
+  STAT_FUNCTION(FN_ANALYZE_POSITIONS);
+  std::istringstream in(lines);
+  std::ostringstream out;
+  analyzeBatch(in, out, {.depth = depth});
+  return out.str();
+}
+
+// A game kept inside the module between calls, so the page passes square indices and small
+// numbers instead of a FEN string per click. Squares are numbered like Position::board and
+// the html board ("a8" == 0, "h1" == 63), promotions like PieceType (KNIGHT == 2 ... QUEEN == 5).
+class GameSession {
+public:
+  GameSession() { load(INITIAL_FEN); }
+  explicit GameSession(const std::string &fen) { load(fen); }
+  
+  // Intent: Start over from a FEN, the move history is cleared
+  // Pre: None
+  // Post: Return false and keep the current game if the FEN is invalid
+  bool load(const std::string &fen) {
+    STAT_FUNCTION(FN_SESSION_LOAD);
+    Position next;
+    if (!parseFEN(fen, next))
+      return false;
+    pos = next;
+    loaded = false;
+    plies.clear();
+    undone.clear();
+    keys.clear();
+    return true;
   }
   
-  // Check if king is in check
-  auto res = getValidTargetSquares(fen, xy2crd(0, 0), true);
-  if (res == "White is in check")
-      return "Checkmate: Black wins";
-  if (res == "Black is in check")
-    return "Checkmate: White wins";
+  // Intent: Get the legal target squares of the piece on square
+  // Pre: None
+  // Post: result == 0 if square > 63 or if it holds no piece of the side to move
+  Bitboard legalTargets(unsigned square) const {
+    STAT_FUNCTION(FN_SESSION_LEGAL_TARGETS);
+    return square < 64 ? ::legalTargets(pos, uint8_t(square)) : 0;
+  }
   
-  return "Stalemate: Draw";
-}
+  // Intent: Play a move, a pawn reaching the last rank needs a promotion type
+  // Pre: None
+  // Post: Return false and change nothing if the move is not legal or promotion is neither 0 nor
+  //       KNIGHT ... QUEEN, or is not 0 for a move that does not promote, otherwise the redo list is cleared
+  bool play(unsigned from, unsigned to, unsigned promotion) {
+    STAT_FUNCTION(FN_SESSION_PLAY);
+    if (std::max(from, to) > 63 || (promotion && (promotion < KNIGHT || promotion > QUEEN)))
+      return false;
+    
+    MoveList legal;
+    generateLegalMoves(pos, legal);
+    CoordMove m{uint8_t(from), uint8_t(to), promotion ? makePiece(pos.activeColor, PieceType(promotion)) : NO_PIECE};
+    Move played = coord2move(pos, m);
+    if (pos.board[from] == NO_PIECE || std::find(legal.begin(), legal.end(), played) == legal.end())
+      return false;
+    
+    undone.clear();
+    push(played);
+    return true;
+  }
+  
+  // Intent: Take back the last move
+  // Pre: None
+  // Post: Return false if no move was played since the last load
+  bool undo() {
+    STAT_FUNCTION(FN_SESSION_UNDO);
+    if (plies.empty())
+      return false;
+    
+    auto [m, info, key] = plies.back();
+    plies.pop_back();
+    unmakeMove(pos, m, info);
+    undone.push_back(m);
+    
+    // the ring buffer may have overwritten older keys, refill it from the plies still played
+    keys.clear();
+    for (size_t i = plies.size() - std::min(plies.size(), KeyHistory::CAPACITY); i < plies.size(); ++i)
+      keys.push(plies[i].key);
+    return true;
+  }
+  
+  // Intent: Play the last move taken back again
+  // Pre: None
+  // Post: Return false if there is nothing to redo
+  bool redo() {
+    STAT_FUNCTION(FN_SESSION_REDO);
+    if (undone.empty())
+      return false;
+    push(undone.back());
+    undone.pop_back();
+    return true;
+  }
+  
+  // Intent: Get the game state, formatted like getGameStateAfterMoves
+  // Pre: None
+  // Post: None
+  std::string state() const {
+    STAT_FUNCTION(FN_SESSION_STATE);
+    return describeState(pos, &keys);
+  }
+  
+  // Intent: Get the FEN of the current position
+  // Pre: None
+  // Post: None
+  std::string fen() const { return data2fen(pos); }
+  
+  const Position &position() const { return pos; }
+  
+  // Intent: Get the board, one piece code per square, for a view without copying
+  // Pre: None
+  // Post: The pointer stays valid as long as the session, the contents change with every move
+  const Piece *board() const { return pos.board; }
+  
+  // Intent: Get the squares whose piece changed since the last call, so a display only
+  //         redraws those, every square counts as changed after load
+  // Pre: None
+  // Post: The next call compares with the current board
+  Bitboard changedSquares() {
+    Bitboard result = 0;
+    for (uint8_t sq = 0; sq < 64; ++sq)
+      result |= Bitboard(shown[sq] != pos.board[sq] || !loaded) << sq;
+    std::copy(std::begin(pos.board), std::end(pos.board), shown);
+    loaded = true;
+    return result;
+  }
+  
+private:
+  struct Ply {
+    Move move;
+    UndoInfo undo;
+    uint64_t key;  // repetitionKey of the position the move was played from
+  };
+  
+  // Intent: Play a legal move and record it
+  // Pre: m is legal in pos
+  // Post: None
+  void push(Move m) {
+    uint64_t key = repetitionKey(pos);
+    keys.push(key);
+    plies.push_back({m, makeMove(pos, m), key});
+  }
+  
+  Position pos;
+  KeyHistory keys;
+  std::vector<Ply> plies;
+  std::vector<Move> undone;
+  Piece shown[64] = {};  // the board at the last changedSquares call
+  bool loaded = false;   // false until changedSquares is called after load
+};
 
 #ifdef EMSCRIPTEN // em++ function bindings
 
 EMSCRIPTEN_BINDINGS(chessModule) {
   function("getGameState", &getGameState);
+  function("getGameStateAfterMoves", &getGameStateAfterMoves);
   function("isValidMove", &isValidMove);
   function("getValidTargetSquares", optional_override([](const std::string& fen, const std::string &crd) {
     return getValidTargetSquares(fen, crd);
   }), allow_raw_pointers());
   function("getNextFEN", &getNextFEN);
+  function("getLegalMoves", &getLegalMoves);
+  function("getPositionKey", &getPositionKey);
+  function("getBestMove", &getBestMove);
+  function("analyzePositions", &analyzePositions);
+  function("sanToMove", &sanToMove);
+  function("loadBook", &loadBook);
+  function("getBookMoves", &getBookMoves);
+  function("getBookMove", &getBookMove);
+  function("generateTablebases", &generateTablebases);
+  function("getTablebaseState", &getTablebaseState);
   function("fenToHtmlClassNames", &fenToHtmlClassNames);
+  function("getStaticExchange", &getStaticExchange);
+  function("getHangingPieces", &getHangingPieces);
+  function("resetStats", &resetStats);
+  
+  // counts are doubles in JS, exact up to 2^53
+  function("getStats", optional_override([] {
+    Stats stats = getStats();
+    val result = val::object(), functions = val::object();
+    result.set("enabled", stats.enabled);
+    for (unsigned i = 0; i < STAT_COUNTERS; ++i)
+      result.set(STAT_COUNTER_NAMES[i], double(stats.counters[i]));
+    for (unsigned f = 0; f < STAT_FUNCTIONS; ++f) {
+      val timing = val::object();
+      timing.set("calls", double(stats.functions[f].calls));
+      timing.set("nanoseconds", double(stats.functions[f].nanoseconds));
+      functions.set(STAT_FUNCTION_NAMES[f], timing);
+    }
+    result.set("functions", functions);
+    return result;
+  }));
+  
+  // squares cross the boundary as JS arrays of square indices, the board as a Uint8Array
+  // view over the module memory that has to be read before the memory can grow again
+  class_<GameSession>("GameSession")
+    .constructor<>()
+    .constructor<std::string>()
+    .function("load", &GameSession::load)
+    .function("legalTargets", optional_override([](const GameSession &session, unsigned square) {
+      val result = val::array();
+      for (Bitboard targets = session.legalTargets(square); targets; )
+        result.call<void>("push", popLsb(targets));
+      return result;
+    }))
+    .function("play", &GameSession::play)
+    .function("undo", &GameSession::undo)
+    .function("redo", &GameSession::redo)
+    .function("board", optional_override([](const GameSession &session) {
+      return val(typed_memory_view(64, reinterpret_cast<const uint8_t *>(session.board())));
+    }))
+    .function("changedSquares", optional_override([](GameSession &session) {
+      val result = val::array();
+      for (Bitboard changed = session.changedSquares(); changed; )
+        result.call<void>("push", popLsb(changed));
+      return result;
+    }))
+    .function("state", &GameSession::state)
+    .function("fen", &GameSession::fen);
 }
 
 #endif // ifdef EMSCRIPTEN
 
 #ifndef EMSCRIPTEN // debug
 
-/*
-mid game benchmark, white to play r3kb1r/1pBnp1pp/p4p2/1N1n1b2/2BP4/5NP1/P4P1P/R1R3K1 w kq - 0 17
-initial state rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 1 1
-checkmate in 6 8/8/8/8/8/4K3/5Q2/7k w - - 11 56
-checkmate in 1 8/8/8/8/8/6K1/4Q3/6k1 w - - 21 61
-github issue 4, castling (slow search) r6r/p3kp1p/4np2/1Bb5/3p4/P4N2/1P3PPP/R3K2R w KQ - 2 18
-github issue 4, no castling r6r/p3kp1p/4np2/1Bb5/3p4/P4N2/1P3PPP/R3K2R w - - 2 18
-mid game benchmark, black to play r3kb1r/ppBnp1pp/5p2/1N1n1b2/2BP4/5NP1/P4P1P/R1R3K1 b kq - 1 16
-late game, rook pins bishop 4k3/4n3/8/3N1R2/4R2p/7P/1r3BK1/8 b - - 6 42
-end game, impossible pawn 4p3/8/8/8/8/k6P/6K1/8 b - - 6 42
-en passant rn1qkbnr/p1p1pppp/8/1pPp4/3P1B2/8/PP2PPPP/Rb1QKBNR w KQkq b6 0 5
-too many pieces rnbqkbnr/pppppppp/nnnnnnnn/PPPPPPPP/pppppppp/NNNNNNNN/PPPPPPPP/RNBQKBNR w KQkq - 1 1
-en passant rnb1r1k1/ppp2ppp/8/8/2PN4/2Nn4/P3BPPP/R3K2R w KQ - 5 14
-github issue 5, castling r3k2Q/pp3p1p/3qp3/2pp2N1/3P4/4PP2/PP1K2PP/nNB4R b k - 0 15
-late-ish 8/p2P1N2/8/4p2k/1p2P3/1P1b2pK/P6P/n7 w - - 0 33
-queening opportunities 4kb1R/1p1np1P1/2B2p2/1N1P1b2/8/5NK1/p3rP1p/8 w - - 0 31
-mate in 1 5k2/8/5K2/4Q3/5P2/8/8/8 w - - 3 61
-incomplete FEN, stalemate rn2k1nr/pp4pp/3p4/q1pP4/P1P2p1b/1b2pPRP/1P1NP1PQ/2B1KBNR w Kkq -
-stalemate 5bnr/4p1pq/4Qpkr/7p/2P4P/8/PP1PPPP1/RNB1KBNR b KQ - 0 10
-stalemate in 1 (Qxe6) 5bnr/4p1pq/2Q1ppkr/7p/2P4P/8/PP1PPPP1/RNB1KBNR w KQ - 0 10
-rook & king 8/7K/8/8/8/8/R7/7k w - - 0 1
-zugzwang 8/8/p1p5/1p5p/1P5p/8/PPP2K1p/4R1rk w - - 0 1
-earlyish rnq1nrk1/pp3pbp/6p1/3p4/3P4/5N2/PP2BPPP/R1BQK2R w KQ -
-checkmate in 2 4kb2/3r1p2/2R3p1/6B1/p6P/P3p1P1/P7/5K2 w - - 0 36
-“leonid's position” q2k2q1/2nqn2b/1n1P1n1b/2rnr2Q/1NQ1QN1Q/3Q3B/2RQR2B/Q2K2Q1 w - -
-insufficient material 8/7K/8/8/8/8/N7/7k w - - 40 40
-sufficient material - knight 8/7K/8/5n2/8/8/N7/7k w - - 40 40
-insufficient material - bishops 8/6BK/7B/6b1/7B/8/1B6/7k w - - 40 40
-sufficient material - opposing bishops 8/6BK/7B/6b1/7B/8/B7/7k w - - 40 40
-sufficient material 8/7K/8/8/7B/8/N7/7k w - - 40 40
-castling; various checks r3k2r/p4p1p/4np2/1Bb5/3p4/P3nN2/1P3PPP/R3K2R w KQkq - 2 18
-Adrian Dușa's en-passant position r2k3B/ppp2p1p/7n/3p4/8/1P3N2/P4qP1/4RRK1 w q - 0 17
-Adrian Dușa's position, no castling r2k3B/ppp2p1p/7n/3p4/8/1P3N2/P4qP1/4RRK1 w - - 0 17
-Adrian Dușa's continuation r7/pp1k1p1p/5B1n/2pp4/8/1P3N2/P4RP1/4R1K1 w q - 3 19
-blatantly false castling claims 8/7K/8/8/8/8/q7/7k w KQq - 40 40
-*/
+#include "debug.h"
+#include "perft.h"
+#include "positions.h"
+#include "selfplay.h"
+#include <chrono>
+#include <filesystem>
+#include <map>
+#include <fstream>
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <regex>
 
+#ifdef COUNT_ALLOCATIONS
 
-#include "debug.h"
-int main() {
+// Calls of operator new by the calling thread, read by bench-targets. Only compiled in on
+// request: every other tool would pay for the hook on each allocation.
+thread_local size_t allocationCount = 0;
+
+void *operator new(size_t size) {
+  ++allocationCount;
+  if (void *p = std::malloc(size ? size : 1))
+    return p;
+  throw std::bad_alloc();
+}
+// not inlined, GCC would see free called on what operator new returned and warn at every delete
+[[gnu::noinline]] void operator delete(void *p) noexcept { std::free(p); }
+[[gnu::noinline]] void operator delete(void *p, size_t) noexcept { std::free(p); }
+
+#endif // ifdef COUNT_ALLOCATIONS
+
+// Intent: Measure the throughput of readFEN over TEST_POSITIONS and of readMove over a few moves
+// Pre: None
+// Post: Print the time per parse and MB/s of each input
+void benchmarkParser(size_t iterations) {
+  using clock = std::chrono::steady_clock;
+  size_t checksum = 0;
+  
+  auto measure = [&](const std::string &name, const char *str, auto parse) {
+    // read the string through a volatile pointer so the parse cannot be hoisted out of the loop
+    const char *volatile data = str;
+    size_t size = std::string_view(str).size();
+    auto start = clock::now();
+    for (size_t i = 0; i < iterations; ++i)
+      checksum += parse(std::string_view(data, size));
+    double seconds = std::chrono::duration<double>(clock::now() - start).count();
+    println(name + ":", seconds / iterations * 1e9, "ns/parse", size * iterations / seconds / 1e6, "MB/s");
+    return seconds;
+  };
+  
+  double fenSeconds = 0;
+  size_t fenBytes = 0;
+  for (const auto &[name, fen, perft] : TEST_POSITIONS) {
+    fenSeconds += measure(name, fen, [](std::string_view sv) { Position pos; return readFEN(sv, pos) == PARSE_OK ? pos.kingSquare[WHITE] : 0; });
+    fenBytes += std::string_view(fen).size() * iterations;
+  }
+  println("FEN total:", std::size(TEST_POSITIONS) * iterations / fenSeconds, "parses/s", fenBytes / fenSeconds / 1e6, "MB/s");
+  println();
+  
+  for (const char *mov : {"e2e4", "e7e8Q", "a2a1n", "e1g1", "h7h8x"})
+    measure(mov, mov, [](std::string_view sv) { CoordMove m; return readMove(sv, m) == PARSE_OK ? m.to : 0; });
+  
+  println("checksum:", checksum);
+}
+
+// Intent: Check that every test position and every position one ply after it survives
+//         parse -> data2fen -> parse with the same FEN and key, and that the key of a parsed FEN
+//         matches the same position reached by a move. Then fuzz readFEN and readMove against the
+//         regular expressions they replaced: mutated FENs and moves have to be accepted exactly
+//         when FEN_PATTERN (with each row 8 squares long and one king per side) or MOVE_PATTERN
+//         accepted them, plus FENs without clocks.
+// Pre: None
+// Post: Print each case, return the number of failed checks
+size_t testFen(size_t iterations) {
+  const std::regex fenPattern("^([rnbqkpRNBQKP1-8]{1,8}\\/){7}[rnbqkpRNBQKP1-8]{1,8} [wb] (-|[kqKQ]{1,4}) (-|[a-h][1-8]) \\d+ \\d+$");
+  const std::regex movePattern("^[a-h][1-8][a-h][1-8](|[nbrqNBRQ])$");
+  size_t failures = 0;
+  auto check = [&](const std::string &name, bool ok) {
+    failures += !ok;
+    println(name + ":", ok ? "ok" : "FAILED");
+  };
+  
+  size_t roundTrips = 0, roundTripFailures = 0;
+  auto roundTrip = [&](const Position &pos) {
+    Position read;
+    ++roundTrips;
+    bool ok = parseFEN(data2fen(pos), read) && data2fen(read) == data2fen(pos) && read.key == pos.key
+              && read.key == read.computeKey() && read.enPassant == pos.enPassant;
+    roundTripFailures += !ok;
+    if (!ok)
+      println("round trip FAILED:", data2fen(pos));
+  };
+  for (const TestPosition &test : TEST_POSITIONS) {
+    Position pos;
+    if (readFEN(test.fen, pos) != PARSE_OK)
+      continue;
+    roundTrip(pos);
+    MoveList moves;
+    generateLegalMoves(pos, moves);
+    for (Move m : moves) {
+      // a few test positions let the king be taken, a FEN without it is invalid
+      if (typeOf(pos.board[m.to()]) == KING)
+        continue;
+      UndoInfo undo = makeMove(pos, m);
+      roundTrip(pos);
+      unmakeMove(pos, m, undo);
+    }
+  }
+  check("round trip of " + std::to_string(roundTrips) + " positions", !roundTripFailures);
+  check("new game prints \"-\" for en passant", GameSession().fen() == INITIAL_FEN);
+  
+  // the old parseFEN: the pattern, then 8 squares per row and one king per side
+  auto oldFen = [&](const std::string &fen) {
+    if (!std::regex_match(fen, fenPattern))
+      return false;
+    size_t squares = 0, kings[2] = {};
+    for (char c : fen.substr(0, fen.find(' ')) + '/') {
+      if (c == '/') {
+        if (squares != 8)
+          return false;
+        squares = 0;
+      } else {
+        squares += isDigit(c) ? c - '0' : 1;
+        kings[0] += c == 'K';
+        kings[1] += c == 'k';
+      }
+    }
+    return kings[0] == 1 && kings[1] == 1;
+  };
+  
+  // random edits drawn from the characters that matter to the formats
+  const std::string alphabet = "rnbqkpRNBQKP012345678/ -wbah9x";
+  uint64_t random = 1;
+  auto mutate = [&](std::string s) {
+    for (size_t edits = 1 + splitMix64(random) % 3; edits--; ) {
+      size_t i = s.size() ? splitMix64(random) % s.size() : 0;
+      char c = alphabet[splitMix64(random) % alphabet.size()];
+      switch (splitMix64(random) % 4) {
+        case 0: if (s.size()) s[i] = c; break;
+        case 1: s.insert(s.begin() + i, c); break;
+        case 2: if (s.size()) s.erase(i, 1); break;
+        case 3: s.resize(i); break;
+      }
+    }
+    return s;
+  };
+  
+  size_t fenMismatches = 0, fenAccepted = 0;
+  for (size_t n = 0; n < iterations; ++n) {
+    std::string fen = mutate(TEST_POSITIONS[n % std::size(TEST_POSITIONS)].fen);
+    Position pos;
+    bool accepted = readFEN(fen, pos) == PARSE_OK, expected = oldFen(fen) || oldFen(fen + " 0 1");
+    fenAccepted += accepted;
+    if (accepted != expected && ++fenMismatches <= 10)
+      println("FEN mismatch:", "\"" + fen + "\"", accepted ? "accepted" : "rejected");
+  }
+  check("readFEN and FEN_PATTERN on " + std::to_string(iterations) + " mutated FENs ("
+        + std::to_string(fenAccepted) + " valid)", !fenMismatches);
+  
+  size_t moveMismatches = 0;
+  for (size_t n = 0; n < iterations; ++n) {
+    std::string mov = mutate(std::array{"e2e4", "e7e8Q", "a2a1n", "h7h8r"}[n % 4]);
+    CoordMove m;
+    bool accepted = readMove(mov, m) == PARSE_OK;
+    if (accepted != std::regex_match(mov, movePattern) && ++moveMismatches <= 10)
+      println("move mismatch:", "\"" + mov + "\"", accepted ? "accepted" : "rejected");
+  }
+  check("readMove and MOVE_PATTERN on " + std::to_string(iterations) + " mutated moves", !moveMismatches);
+  
+  println(failures, "failures");
+  return failures;
+}
+
+// Intent: Measure the time and the heap allocations of the target square queries of every square
+//         of the test positions, through the caller-supplied buffer and through the std::string API
+// Pre: iterations >= 1
+// Post: Return the number of allocations of the buffer path, which has to be 0, allocations are
+//       only counted when built with -DCOUNT_ALLOCATIONS
+size_t benchmarkTargets(size_t iterations) {
+  using clock = std::chrono::steady_clock;
+  std::vector<std::pair<std::string, std::string>> queries;
+  for (const TestPosition &test : TEST_POSITIONS)
+    for (uint8_t sq = 0; sq < 64; ++sq)
+      queries.emplace_back(test.fen, xy2crd(sq % 8, sq / 8));
+  size_t checksum = 0;
+  
+  auto measure = [&](const std::string &name, auto query) {
+#ifdef COUNT_ALLOCATIONS
+    size_t before = allocationCount;
+#endif
+    auto start = clock::now();
+    for (size_t i = 0; i < iterations; ++i)
+      for (const auto &[fen, src] : queries)
+        checksum += query(fen, src);
+    double seconds = std::chrono::duration<double>(clock::now() - start).count();
+    size_t calls = iterations * queries.size();
+#ifdef COUNT_ALLOCATIONS
+    size_t allocations = allocationCount - before;
+    println(name + ":", seconds / calls * 1e9, "ns/call", double(allocations) / calls, "allocations/call");
+    return allocations;
+#else
+    println(name + ":", seconds / calls * 1e9, "ns/call");
+    return size_t(0);
+#endif
+  };
+  
+  size_t buffered = measure("writeTargets", [](const std::string &fen, const std::string &src) {
+    char buffer[TARGETS_BUFFER_SIZE];
+    Position pos;
+    auto [x, y] = crd2pos(src);
+    return parseFEN(fen, pos) ? writeTargets(pos, xy2sq(x, y), buffer) : 0;
+  });
+  measure("getValidTargetSquares", [](const std::string &fen, const std::string &src) {
+    return getValidTargetSquares(fen, src).size();
+  });
+  measure("writeMoves", [](const std::string &fen, const std::string &) {
+    char buffer[MOVES_BUFFER_SIZE];
+    Position pos;
+    MoveList moves;
+    if (!parseFEN(fen, pos))
+      return size_t(0);
+    generateLegalMoves(pos, moves);
+    return writeMoves(moves, pos.activeColor, buffer);
+  });
+#ifndef COUNT_ALLOCATIONS
+  println("build with -DCOUNT_ALLOCATIONS to count the allocations per call");
+#endif
+  println("checksum:", checksum);
+  return buffered;
+}
+
+// Median and 99th percentile of the samples of one microbenchmark, in nanoseconds per call
+struct ApiTiming {
+  std::string name;
+  double median;
+  double p99;
+};
+
+// Intent: Time one exported function over queries made from the test positions. Passes over
+//         every query run for 20 ms to warm up, which also sizes a sample to about 1 ms,
+//         then each of the samples is timed on its own.
+// Pre: queries is not empty, samples >= 1
+// Post: None
+template<class Query, class Call>
+ApiTiming timeApi(const std::string &name, const std::vector<Query> &queries, size_t samples, Call call) {
+  using clock = std::chrono::steady_clock;
+  size_t checksum = 0;
+  auto pass = [&] {
+    for (const Query &query : queries)
+      checksum += call(query);
+  };
+  
+  size_t passes = 0;
+  auto start = clock::now();
+  for (; clock::now() - start < std::chrono::milliseconds(20); ++passes)
+    pass();
+  size_t repeat = std::max<size_t>(passes / 20, 1);
+  
+  std::vector<double> times(samples);
+  for (double &time : times) {
+    auto sampleStart = clock::now();
+    for (size_t i = 0; i < repeat; ++i)
+      pass();
+    time = std::chrono::duration<double, std::nano>(clock::now() - sampleStart).count() / (repeat * queries.size());
+  }
+  volatile size_t sink = checksum;
+  (void)sink;
+  
+  std::sort(times.begin(), times.end());
+  return {name, times[times.size() / 2], times[std::min(times.size() * 99 / 100, times.size() - 1)]};
+}
+
+// Intent: Time the functions the page calls on every interaction, over every test position
+//         (per square for getValidTargetSquares, the first legal move for getNextFEN and isValidMove)
+// Pre: samples >= 1
+// Post: None
+std::vector<ApiTiming> benchmarkApi(size_t samples) {
+  std::vector<std::string> fens;
+  std::vector<Position> positions;
+  std::vector<std::pair<std::string, std::string>> squares, moves;
+  for (const TestPosition &test : TEST_POSITIONS) {
+    fens.push_back(test.fen);
+    Position pos;
+    if (!parseFEN(test.fen, pos))
+      continue;
+    positions.push_back(pos);
+    for (uint8_t sq = 0; sq < 64; ++sq)
+      squares.emplace_back(test.fen, xy2crd(sq % 8, sq / 8));
+    std::string legal = getLegalMoves(test.fen);
+    if (legal.size())
+      moves.emplace_back(test.fen, legal.substr(0, legal.find('\0')));
+  }
+  
+  using Query = std::pair<std::string, std::string>;
+  return {
+    timeApi("parseFEN", fens, samples, [](const std::string &fen) { Position pos; return size_t(parseFEN(fen, pos)); }),
+    timeApi("data2fen", positions, samples, [](const Position &pos) { return data2fen(pos).size(); }),
+    timeApi("getNextFEN", moves, samples, [](const Query &q) { return getNextFEN(q.first, q.second).size(); }),
+    timeApi("getValidTargetSquares", squares, samples, [](const Query &q) { return getValidTargetSquares(q.first, q.second).size(); }),
+    timeApi("isValidMove", moves, samples, [](const Query &q) { return size_t(isValidMove(q.first, q.second)); }),
+    timeApi("getLegalMoves", fens, samples, [](const std::string &fen) { return getLegalMoves(fen).size(); }),
+    timeApi("getGameState", fens, samples, [](const std::string &fen) { return getGameState(fen).size(); }),
+    timeApi("fenToHtmlClassNames", fens, samples, [](const std::string &fen) { return fenToHtmlClassNames(fen).size(); }),
+  };
+}
+
+// Intent: Read the medians of a file written by bench-api --json, one benchmark per line
+// Pre: None
+// Post: Return false if the file cannot be read, lines without a name and a median are skipped
+bool readApiBaseline(const std::string &path, std::map<std::string, double> &medians) {
+  std::ifstream in(path);
+  if (!in)
+    return false;
+  for (std::string line; std::getline(in, line); ) {
+    size_t name = line.find("\"name\": \""), median = line.find("\"median\": ");
+    if (name == std::string::npos || median == std::string::npos)
+      continue;
+    name += 9;
+    medians[line.substr(name, line.find('"', name) - name)] = std::strtod(line.c_str() + median + 10, nullptr);
+  }
+  return true;
+}
+
+// Intent: Run the API microbenchmarks and print them as text or JSON, compared with the
+//         medians of a baseline file if one is given
+// Pre: samples >= 1
+// Post: Return the number of functions whose median is more than threshold percent slower
+//       than the baseline, or -1 if the baseline cannot be read
+int runApiBenchmarks(size_t samples, bool json, const std::string &baseline, double threshold) {
+  std::map<std::string, double> medians;
+  if (baseline.size() && !readApiBaseline(baseline, medians)) {
+    println(baseline + ":", "cannot read the baseline");
+    return -1;
+  }
+  
+  std::vector<ApiTiming> timings = benchmarkApi(samples);
+  int regressions = 0;
+  if (json)
+    std::cout << "{\"samples\": " << samples << ", \"threshold\": " << threshold << ", \"benchmarks\": [";
+  for (size_t i = 0; i < timings.size(); ++i) {
+    const auto &[name, median, p99] = timings[i];
+    auto old = medians.find(name);
+    double change = old != medians.end() && old->second > 0 ? (median / old->second - 1) * 100 : 0;
+    bool regression = change > threshold;
+    regressions += regression;
+    if (json) {
+      // one benchmark per line, readApiBaseline depends on it
+      std::cout << (i ? "," : "") << "\n  {\"name\": \"" << name << "\", \"median\": " << median << ", \"p99\": " << p99;
+      if (old != medians.end())
+        std::cout << ", \"baseline\": " << old->second << ", \"change\": " << change
+                  << ", \"regression\": " << (regression ? "true" : "false");
+      std::cout << "}";
+    } else if (old != medians.end()) {
+      println(name + ":", median, "ns median", p99, "ns p99, baseline", old->second, "ns,",
+              (change > 0 ? "+" : "") + std::to_string(change) + "%", regression ? "REGRESSION" : "");
+    } else {
+      println(name + ":", median, "ns median", p99, "ns p99");
+    }
+  }
+  if (json)
+    std::cout << "\n], \"regressions\": " << regressions << "}" << std::endl;
+  else if (baseline.size())
+    println(regressions, "regressions over", threshold, "%");
+  return regressions;
+}
+
+// Intent: Count the perft nodes of every test position and compare them with the reference counts,
+//         a transposition table of hashMB megabytes is used if hashMB != 0
+// Pre: 1 <= depth <= MAX_PERFT_DEPTH
+// Post: Print nodes, wall time and nodes/s of each position as text or as one JSON object,
+//       return the number of positions whose count differs from a known reference count
+size_t runPerft(unsigned depth, bool json, size_t hashMB) {
+  using clock = std::chrono::steady_clock;
+  size_t failures = 0;
+  uint64_t totalNodes = 0;
+  double totalSeconds = 0;
+  std::unique_ptr<TranspositionTable> tt;
+  TTStats stats{};
+  if (hashMB)
+    tt = std::make_unique<TranspositionTable>(hashMB);
+  
+  if (json)
+    std::cout << "{\"depth\": " << depth << ", \"hashMB\": " << hashMB << ", \"positions\": [";
+  
+  for (size_t i = 0; i < std::size(TEST_POSITIONS); ++i) {
+    const TestPosition &test = TEST_POSITIONS[i];
+    // positions the parser rejects have no moves to count
+    Position pos;
+    bool valid = readFEN(test.fen, pos) == PARSE_OK;
+    
+    auto start = clock::now();
+    uint64_t nodes = !valid ? 0 : tt ? hashedPerft(pos, depth, *tt, stats) : perft(pos, depth);
+    double seconds = std::chrono::duration<double>(clock::now() - start).count();
+    uint64_t expected = test.perft[depth - 1];
+    bool ok = !expected || nodes == expected;
+    failures += !ok;
+    totalNodes += nodes;
+    totalSeconds += seconds;
+    
+    std::string status = !valid ? "invalid FEN" : !expected ? "unknown" : ok ? "ok" : "MISMATCH";
+    if (json) {
+      // none of the names contain characters that need escaping
+      std::cout << (i ? ", " : "") << "\n  {\"name\": \"" << test.name << "\", \"fen\": \"" << test.fen
+                << "\", \"nodes\": " << nodes << ", \"expected\": " << expected << ", \"status\": \"" << status
+                << "\", \"seconds\": " << seconds << ", \"nps\": " << uint64_t(nodes / seconds) << "}";
+    } else {
+      println(test.name + std::string(":"), nodes, "nodes", status, seconds, "s", uint64_t(nodes / seconds), "nodes/s");
+      if (!ok)
+        println("  expected", expected, "nodes for", test.fen);
+    }
+  }
+  
+  if (json) {
+    std::cout << "\n], \"nodes\": " << totalNodes << ", \"seconds\": " << totalSeconds << ", \"nps\": "
+              << uint64_t(totalNodes / totalSeconds) << ", \"failures\": " << failures;
+    if (tt)
+      std::cout << ", \"tt\": {\"hits\": " << stats.hits << ", \"misses\": " << stats.misses
+                << ", \"stores\": " << stats.stores << ", \"collisions\": " << stats.collisions << "}";
+    std::cout << "}" << std::endl;
+  } else {
+    println("total:", totalNodes, "nodes", totalSeconds, "s", uint64_t(totalNodes / totalSeconds), "nodes/s", failures, "failures");
+    if (tt)
+      println("tt:", stats.hits, "hits", stats.misses, "misses", stats.stores, "stores", stats.collisions, "collisions");
+  }
+  return failures;
+}
+
+// Intent: Print the perft nodes below each legal move of a position, used to find move generator bugs
+// Pre: depth >= 1
+// Post: Return false if the FEN is invalid
+bool runDivide(unsigned depth, const std::string &fen) {
+  Position pos;
+  if (!parseFEN(fen, pos))
+    return false;
+  
+  uint64_t total = 0;
+  for (auto [m, nodes] : divide(pos, depth)) {
+    println(move2crd(m, pos.activeColor) + ":", nodes);
+    total += nodes;
+  }
+  println();
+  println("total:", total);
+  return true;
+}
+
+// Intent: Walk the move tree of every test position and compare the incremental key with a full recompute
+// Pre: None
+// Post: Print each position that has a mismatch, return the number of mismatching nodes
+size_t verifyKeys(unsigned depth) {
+  size_t mismatches = 0;
+  
+  auto walk = [&](auto &self, Position &pos, unsigned depth) -> void {
+    mismatches += pos.key != pos.computeKey();
+    if (depth == 0)
+      return;
+    MoveList moves;
+    generateLegalMoves(pos, moves);
+    for (const Move &m : moves) {
+      uint64_t before = pos.key;
+      UndoInfo undo = makeMove(pos, m);
+      self(self, pos, depth - 1);
+      unmakeMove(pos, m, undo);
+      mismatches += pos.key != before || pos.key != pos.computeKey();
+    }
+  };
+  
+  for (const TestPosition &test : TEST_POSITIONS) {
+    Position pos;
+    if (readFEN(test.fen, pos) != PARSE_OK)
+      continue;
+    size_t before = mismatches;
+    walk(walk, pos, depth);
+    if (mismatches != before)
+      println(test.name + std::string(":"), mismatches - before, "key mismatches");
+  }
+  println("total:", mismatches, "key mismatches");
+  return mismatches;
+}
+
+// Intent: Search every test position to a fixed depth and report the time it took to get there
+// Pre: depth >= 1, threads >= 1
+// Post: Print the best move, score, nodes, time to depth and nodes/s of each position and the
+//       table use of all of them, the positions are evaluated with network if it is not nullptr
+void benchmarkSearch(unsigned depth, unsigned threads, size_t hashMB, const Network *network) {
+  TranspositionTable tt(hashMB);
+  uint64_t totalNodes = 0;
+  double totalSeconds = 0;
+  TTStats totalTT{};
+  
+  for (const TestPosition &test : TEST_POSITIONS) {
+    Position pos;
+    if (readFEN(test.fen, pos) != PARSE_OK)
+      continue;
+    tt.clear();
+    SearchResult result = search(pos, {.depth = depth, .threads = threads}, tt, network);
+    totalNodes += result.nodes;
+    totalSeconds += result.seconds;
+    totalTT += result.tt;
+    println(test.name + std::string(":"), result.depth ? move2crd(result.bestMove, pos.activeColor) : "(none)",
+            "score", result.score, "depth", result.depth, result.nodes, "nodes", result.seconds, "s",
+            uint64_t(result.nodes / result.seconds), "nodes/s");
+  }
+  println("total:", totalNodes, "nodes", totalSeconds, "s", uint64_t(totalNodes / totalSeconds), "nodes/s");
+  println("tt:", totalTT.hits, "hits", totalTT.misses, "misses", totalTT.stores, "stores", totalTT.collisions, "collisions");
+}
+
+// Intent: Count the nodes and the time to reach depth on the middle game test positions with
+//         each move ordering, the table is cleared before each search
+// Pre: depth >= 1
+// Post: Return false if an ordering changes the score of a position. A different best move with
+//       the same score is printed but does not fail: with fail-soft bounds the first of several
+//       equal moves wins, and which one is searched first is what the ordering changes
+bool benchmarkOrdering(unsigned depth, size_t hashMB) {
+  TranspositionTable tt(hashMB);
+  std::map<std::string, SearchResult> reference;
+  uint64_t baseNodes = 0;
+  bool same = true;
+  
+  for (MoveOrdering ordering : {ORDER_NONE, ORDER_MVV_LVA, ORDER_FULL}) {
+    uint64_t nodes = 0;
+    double seconds = 0;
+    TTStats ttStats{};
+    for (const TestPosition &test : TEST_POSITIONS) {
+      std::string_view name = test.name;
+      Position pos;
+      if (!(name.starts_with("mid game benchmark") || name.starts_with("github issue 4") || name == "earlyish")
+          || readFEN(test.fen, pos) != PARSE_OK)
+        continue;
+      tt.clear();
+      SearchResult result = search(pos, {.depth = depth, .ordering = ordering}, tt);
+      nodes += result.nodes;
+      seconds += result.seconds;
+      ttStats += result.tt;
+      println(std::string(MOVE_ORDERING_TEXT[ordering]) + ", " + test.name + ":", move2crd(result.bestMove, pos.activeColor),
+              "score", result.score, result.nodes, "nodes", result.seconds, "s");
+      auto [it, first] = reference.emplace(test.fen, result);
+      same = same && (first || it->second.score == result.score);
+      if (!first && it->second.score == result.score && it->second.bestMove != result.bestMove)
+        println("  best move differs from", move2crd(it->second.bestMove, pos.activeColor), "with the same score");
+    }
+    if (ordering == ORDER_NONE)
+      baseNodes = nodes;
+    println(std::string(MOVE_ORDERING_TEXT[ordering]) + ":", nodes, "nodes", seconds, "s",
+            double(baseNodes) / nodes, "times fewer nodes than none");
+    println("  tt:", ttStats.hits, "hits", ttStats.misses, "misses", ttStats.stores, "stores", ttStats.collisions, "collisions");
+  }
+  if (!same)
+    println("the score of a position depends on the ordering");
+  return same;
+}
+
+// Intent: Check the static exchange evaluation and the hanging pieces on small positions
+// Pre: None
+// Post: Return the number of failures
+size_t testSee() {
+  size_t failures = 0;
+  auto check = [&](const std::string &name, const std::string &result, const std::string &expected) {
+    failures += result != expected;
+    println(name + ":", result, result == expected ? "ok" : "FAILED");
+  };
+  auto list = [](std::string squares) { std::replace(squares.begin(), squares.end(), '\0', ' '); return squares; };
+  
+  check("free pawn", getStaticExchange("1k1r4/1pp4p/p7/4p3/8/P5P1/1PP4P/2K1R3 w - - 0 1", "e1e5"), "100");
+  check("defended pawn", getStaticExchange("1k1r3q/1ppn3p/p4b2/4p3/8/P2N2P1/1PP1R1BP/2K1Q3 w - - 0 1", "d3e5"), "-220");
+  check("x-ray", getStaticExchange("4k3/8/8/3p4/8/8/3R4/3RK3 w - - 0 1", "d2d5"), "100");
+  check("queen into a pawn", getStaticExchange("4k3/8/4p3/8/8/8/8/3QK3 w - - 0 1", "d1d5"), "-900");
+  check("safe quiet move", getStaticExchange(INITIAL_FEN, "e2e4"), "0");
+  check("en passant", getStaticExchange("4k3/8/8/3pP3/8/8/8/4K3 w - d6 0 1", "e5d6"), "100");
+  check("promotion", getStaticExchange("3rk3/2P5/8/8/8/8/8/4K3 w - - 0 1", "c7d8Q"), "400");
+  check("king cannot take back", getStaticExchange("3rk3/8/8/8/8/8/3r4/3QK3 b - - 0 1", "d2d1"), "900");
+  check("illegal move", getStaticExchange(INITIAL_FEN, "e2e5"), "");
+  check("34 captures", getStaticExchange("3Q2KQ/q2Qk1Q1/1qnqNq2/1NQqqn2/QqQqQqqQ/1NQqQN2/1qNqnQ2/q2q2Q1 w - - 0 1", "b5d4"), "900");
+  check("hanging knight", list(getHangingPieces("4k3/8/8/3n4/8/8/8/3RK3 w - - 0 1")), "d5");
+  check("defended knight", list(getHangingPieces("4k3/8/4p3/3n4/8/8/8/3RK3 w - - 0 1")), "");
+  check("both sides", list(getHangingPieces("4k3/8/1q6/3n4/8/8/8/1R1RK3 b - - 0 1")), "b6 d5");
+  check("initial position", list(getHangingPieces(INITIAL_FEN)), "");
+  
+  println(failures, "failures");
+  return failures;
+}
+
+// Intent: Load a network file, "pst" names the network built from eval.h's tables
+// Pre: None
+// Post: net is only replaced if the file is valid
+NnueStatus loadNetworkFile(const std::string &path, std::unique_ptr<Network> &net) {
+  if (path == "pst") {
+    net = Network::fromPieceSquareTables();
+    return NNUE_OK;
+  }
+  std::ifstream in(path, std::ios::binary);
+  return in ? Network::load(in, net) : NNUE_CANNOT_OPEN;
+}
+
+// Intent: Measure the evaluations per second of every compiled backend over random games from the
+//         test positions, once updating the accumulator move by move and once refreshing it
+// Pre: None
+// Post: Print evals/s per backend, return the number of evaluations where a backend differs from
+//       the scalar kernels or an updated accumulator differs from a refreshed one
+size_t benchmarkNnue(Network &net, size_t iterations) {
+  using clock = std::chrono::steady_clock;
+  
+  // random games of up to 64 plies, the same for every backend
+  std::vector<std::pair<Position, Move>> plies;
+  std::vector<size_t> gameStarts;
+  uint64_t seed = 0x9E3779B97F4A7C15ull;
+  for (const TestPosition &test : TEST_POSITIONS) {
+    Position pos;
+    if (readFEN(test.fen, pos) != PARSE_OK)
+      continue;
+    gameStarts.push_back(plies.size());
+    for (size_t ply = 0; ply < 64; ++ply) {
+      MoveList moves;
+      generateLegalMoves(pos, moves);
+      if (!moves.size())
+        break;
+      seed = seed * 6364136223846793005ull + 1442695040888963407ull;
+      Move m = moves[(seed >> 33) % moves.size()];
+      plies.push_back({pos, m});
+      makeMove(pos, m);
+    }
+  }
+  gameStarts.push_back(plies.size());
+  
+  // scores of the scalar kernels, compared with every other backend and with a refresh
+  std::vector<int> reference;
+  size_t failures = 0;
+  int64_t classicalDifference = 0;
+  for (NnueBackend backend : NNUE_BACKENDS) {
+    net.setBackend(backend);
+    std::vector<int> scores;
+    Accumulator acc[2];
+    int64_t checksum = 0;
+    
+    auto start = clock::now();
+    for (size_t n = 0; n < iterations; ++n) {
+      for (size_t g = 0; g + 1 < gameStarts.size(); ++g) {
+        net.refresh(plies[gameStarts[g]].first, acc[0]);
+        for (size_t i = gameStarts[g]; i < gameStarts[g + 1]; ++i) {
+          const auto &[pos, m] = plies[i];
+          net.update(acc[(i - gameStarts[g]) % 2], acc[(i - gameStarts[g] + 1) % 2], pos, m);
+          int score = net.evaluate(acc[(i - gameStarts[g] + 1) % 2], Color(!pos.activeColor));
+          checksum += score;
+          if (!n)
+            scores.push_back(score);
+        }
+      }
+    }
+    double incremental = std::chrono::duration<double>(clock::now() - start).count();
+    
+    start = clock::now();
+    for (size_t n = 0; n < iterations; ++n) {
+      for (const auto &[pos, m] : plies) {
+        Position next = pos;
+        makeMove(next, m);
+        checksum -= net.evaluate(next);
+      }
+    }
+    double refresh = std::chrono::duration<double>(clock::now() - start).count();
+    
+    if (reference.empty())
+      reference = scores;
+    size_t mismatches = checksum != 0;
+    for (size_t i = 0; i < scores.size(); ++i)
+      mismatches += scores[i] != reference[i];
+    failures += mismatches;
+    println(std::string(NNUE_BACKEND_NAMES[backend]) + ":", uint64_t(plies.size() * iterations / incremental), "evals/s incremental",
+            uint64_t(plies.size() * iterations / refresh), "evals/s refresh", mismatches ? "MISMATCH" : "ok");
+  }
+  
+  for (size_t i = 0; i < plies.size(); ++i) {
+    Position next = plies[i].first;
+    makeMove(next, plies[i].second);
+    classicalDifference += std::abs(reference[i] - evaluate(next));
+  }
+  println(plies.size(), "positions, mean difference to eval.h:", double(classicalDifference) / plies.size(), "cp");
+  println(failures, "failures");
+  return failures;
+}
+
+// Intent: Search the mid game benchmark positions with 1, 2, 4, ... threads up to the core count
+// Pre: depth >= 1
+// Post: Print the time to depth, the speedup over 1 thread and the nodes/s of each thread count
+void benchmarkThreads(unsigned depth, size_t hashMB) {
+  TranspositionTable tt(hashMB);
+  unsigned cores = std::max(std::thread::hardware_concurrency(), 1u);
+  double baseSeconds = 0;
+  
+  std::vector<unsigned> counts;
+  for (unsigned threads = 1; threads < cores; threads *= 2)
+    counts.push_back(threads);
+  counts.push_back(cores);
+  
+  for (unsigned threads : counts) {
+    uint64_t nodes = 0;
+    double seconds = 0;
+    for (const TestPosition &test : TEST_POSITIONS) {
+      Position pos;
+      if (!std::string_view(test.name).starts_with("mid game benchmark") || readFEN(test.fen, pos) != PARSE_OK)
+        continue;
+      tt.clear();
+      SearchResult result = search(pos, {.depth = depth, .threads = threads}, tt);
+      nodes += result.nodes;
+      seconds += result.seconds;
+    }
+    if (threads == 1)
+      baseSeconds = seconds;
+    println(threads, "threads:", seconds, "s", "speedup", baseSeconds / seconds, nodes, "nodes", uint64_t(nodes / seconds), "nodes/s");
+  }
+}
+
+// Intent: Check that the search finds the mates and avoids the stalemate of the named test positions
+// Pre: None
+// Post: Print each check, return the number of failed checks
+size_t testSearch() {
+  TranspositionTable tt(16);
+  size_t failures = 0;
+  
+  auto check = [&](const char *name, unsigned depth, auto predicate) {
+    auto test = std::find_if(std::begin(TEST_POSITIONS), std::end(TEST_POSITIONS),
+                             [&](const TestPosition &t) { return std::string_view(t.name) == name; });
+    Position pos;
+    readFEN(test->fen, pos);
+    tt.clear();
+    SearchResult result = search(pos, {depth}, tt);
+    std::string move = move2crd(result.bestMove, pos.activeColor);
+    std::string next = getNextFEN(test->fen, move);
+    bool ok = predicate(result, move, next);
+    failures += !ok;
+    println(std::string(name) + ":", move, "score", result.score, "depth", result.depth, ok ? "ok" : "FAILED");
+  };
+  
+  // a mate in n moves scores MATE - (2n - 1)
+  for (auto [name, moves] : {std::pair{"checkmate in 1", 1}, {"mate in 1", 1}, {"checkmate in 2", 2}, {"checkmate in 6", 6}}) {
+    check(name, 2 * moves + 1, [moves](const SearchResult &r, const std::string &, const std::string &next) {
+      return r.score >= MATE - (2 * moves - 1) && (moves > 1 || getGameState(next).starts_with("Checkmate"));
+    });
+  }
+  check("stalemate in 1 (Qxe6)", 4, [](const SearchResult &r, const std::string &move, const std::string &next) {
+    return move != "c6e6" && r.score > 0 && getGameState(next) != "Stalemate: Draw";
+  });
+  
+  println(failures, "failures");
+  return failures;
+}
+
+// Intent: Check the draw rules on the material test positions and on a few short games
+// Pre: None
+// Post: Print each case, return the number of cases with an unexpected state
+size_t testDraws() {
+  const std::string start = "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1";
+  size_t failures = 0;
+  
+  auto check = [&](const std::string &name, const std::string &state, const std::string &expected) {
+    failures += state != expected;
+    println(name + ":", state, state == expected ? "ok" : "FAILED");
+  };
+  
+  for (auto [name, expected] : {std::pair{"insufficient material", "Insufficient material: Draw"},
+                                {"sufficient material - knight", "White to move"},
+                                {"insufficient material - bishops", "Insufficient material: Draw"},
+                                {"sufficient material - opposing bishops", "White to move"}}) {
+    auto test = std::find_if(std::begin(TEST_POSITIONS), std::end(TEST_POSITIONS),
+                             [&](const TestPosition &t) { return std::string_view(t.name) == name; });
+    check(name, getGameState(test->fen), expected);
+  }
+  check("fifty moves", getGameState("8/8/4k3/8/8/3K4/3R4/8 w - - 100 80"), "Fifty-move rule: Draw");
+  check("mate on the fiftieth move", getGameState("7k/6Q1/6K1/8/8/8/8/8 b - - 100 80"), "Checkmate: White wins");
+  
+  // the start position occurs a third time after two knight dances, the en passant square
+  // after e2e4 cannot be taken and does not make the position different
+  check("two repetitions", getGameStateAfterMoves(start, "g1f3 g8f6 f3g1 f6g8"), "White to move");
+  check("threefold repetition", getGameStateAfterMoves(start, "g1f3 g8f6 f3g1 f6g8 g1f3 g8f6 f3g1 f6g8"),
+        "Threefold repetition: Draw");
+  check("repetition after a double step", getGameStateAfterMoves(start, "e2e4 g8f6 g1f3 f6g8 f3g1 g8f6 g1f3 f6g8 f3g1"),
+        "Threefold repetition: Draw");
+  check("pawn move in between", getGameStateAfterMoves(start, "g1f3 g8f6 f3g1 f6g8 e2e3 g8f6 g1f3 f6g8 f3g1"),
+        "Black to move");
+  check("illegal move", getGameStateAfterMoves(start, "g1f3 e8e7"), "Invalid move");
+  
+  println(failures, "failures");
+  return failures;
+}
+
+// Intent: Write a book from a few games, map it and check the moves, the selection and a
+//         book holding every position of the first two plies
+// Pre: None
+// Post: Print each case, return the number of cases with an unexpected result
+size_t testBook() {
+  const std::string start = INITIAL_FEN;
+  size_t failures = 0;
+  auto check = [&](const std::string &name, const std::string &result, const std::string &expected) {
+    failures += result != expected;
+    println(name + ":", result, result == expected ? "ok" : "FAILED");
+  };
+  
+  const char *games =
+    "[Event \"1\"]\n1. e4 e5 2. Nf3 Nc6 3. Bb5 Nf6 4. O-O Nxe4 1-0\n"
+    "[Event \"2\"]\n1. e4 e5 2. Nf3 Nc6 3. Bc4 Bc5 1/2-1/2\n"
+    "[Event \"3\"]\n1. e4 c5 2. Nf3 d6 3. d4 cxd4 0-1\n"
+    "[Event \"4\"]\n1. d4 d5 2. c4 e6 3. Nc3 Nf6 *\n"
+    "[Event \"5\"]\n1. e4 d5 2. exd5 Qxd5 3. Nc3 Qa5 4. d4 c6 5. Nf3 Bf5 6. Bd2 e6 7. Qe2 Bb4 8. O-O-O *\n"
+    "[FEN \"8/P6k/8/8/8/8/8/K7 w - - 0 1\"]\n1. a8=N Kg6 *\n"
+    "[FEN \"4k3/8/8/8/2pP4/8/8/4K3 b - d3 0 1\"]\n1... cxd3 *\n";
+  std::istringstream pgn(games);
+  WorkerPool pool(1);
+  BookWriter writer;
+  validatePgn(pgn, pool, 4, [](const GameReport &) {}, [&](const Position &pos, Move m, uint32_t ply) {
+    if (ply < BOOK_PLIES + 4)
+      writer.add(pos, m);
+  });
+  std::string path = (std::filesystem::temp_directory_path() / "module-test-book.bin").string();
+  {
+    std::ofstream out(path, std::ios::binary);
+    check("entries", std::to_string(writer.write(out)), "38");
+  }
+  check("open", BOOK_STATUS_TEXT[Book::open(path, openingBook)], "ok");
+  
+  // the keys of the Polyglot book format description, any standard book is built on them
+  for (auto [moves, expected] : {std::pair{"", 0x463b96181691fc9cull}, {"e2e4", 0x823c9b50fd114196ull},
+                                 {"e2e4 d7d5", 0x0756b94461c50fb0ull}, {"e2e4 d7d5 e4e5", 0x662fafb965db29d4ull},
+                                 {"e2e4 d7d5 e4e5 f7f5", 0x22a48b5a8e47ff78ull},
+                                 {"e2e4 d7d5 e4e5 f7f5 e1e2", 0x652a607ca3f242c1ull},
+                                 {"e2e4 d7d5 e4e5 f7f5 e1e2 e8f7", 0x00fdd303c946bdd9ull},
+                                 {"a2a4 b7b5 h2h4 b5b4 c2c4", 0x3c8123ea7b067637ull},
+                                 {"a2a4 b7b5 h2h4 b5b4 c2c4 b4c3 a1a3", 0x5c3f9b829b279560ull}}) {
+    std::string fen = start;
+    std::istringstream in(moves);
+    for (std::string mov; in >> mov; )
+      fen = getNextFEN(fen, mov);
+    Position pos;
+    parseFEN(fen, pos);
+    std::ostringstream key;
+    key << std::hex << polyglotKey(pos);
+    check(std::string("key after \"") + moves + '"', key.str(), (std::ostringstream() << std::hex << expected).str());
+  }
+  
+  auto list = [](std::string moves) { std::replace(moves.begin(), moves.end(), '\0', ' '); return moves; };
+  check("initial position", list(getBookMoves(start)), "e2e4 d2d4");
+  check("best move", getBookMove(start, "best"), "e2e4");
+  check("after 1. e4", list(getBookMoves(getNextFEN(start, "e2e4"))), "e7e5 c7c5 d7d5");
+  check("castling kingside", getBookMove("r1bqkb1r/pppp1ppp/2n2n2/1B2p3/4P3/5N2/PPPP1PPP/RNBQK2R w KQkq - 4 4", "best"),
+        "e1g1");
+  check("castling queenside", getBookMove("rn2k1nr/pp3ppp/2p1p3/q4b2/1b1P4/2N2N2/PPPBQPPP/R3KB1R w KQkq - 4 8", "best"),
+        "e1c1");
+  check("underpromotion", getBookMove("8/P6k/8/8/8/8/8/K7 w - - 0 1", "best"), "a7a8N");
+  check("en passant", getBookMove("4k3/8/8/8/2pP4/8/8/4K3 b - d3 0 1", "best"), "c4d3");
+  check("without the en passant square", getBookMoves("4k3/8/8/8/2pP4/8/8/4K3 b - - 0 1"), "");
+  check("not in the book", getBookMoves("rnbqkbnr/pppppppp/8/8/8/7N/PPPPPPPP/RNBQKB1R b KQkq - 1 1"), "");
+  check("unknown mode", getBookMove(start, "worst"), "");
+  check("book move without search", getBestMove(getNextFEN(start, "d2d4"), "depth 1"), "d7d5");
+  
+  // 4 of the 5 games open with e4
+  size_t e4 = 0;
+  for (size_t i = 0; i < 10000; ++i)
+    e4 += getBookMove(start, "random") == "e2e4";
+  check("weighted random e2e4 of 10000", e4 > 7700 && e4 < 8300 ? "about 8000" : std::to_string(e4), "about 8000");
+  
+  check("bad size", loadBook(std::string(17, '\0')) ? "loaded" : "rejected", "rejected");
+  check("book kept", getBookMove(start, "best"), "e2e4");
+  
+  // every move of every position up to 2 plies, each probe has to find all legal moves
+  BookWriter full;
+  std::vector<Position> positions;
+  auto addAll = [&](const Position &pos) {
+    MoveList moves;
+    generateLegalMoves(pos, moves);
+    for (Move m : moves) {
+      full.add(pos, m);
+      positions.push_back(pos);
+      makeMove(positions.back(), m);
+    }
+  };
+  Position root;
+  parseFEN(start, root);
+  addAll(root);
+  for (size_t i = 0, n = positions.size(); i < n; ++i)
+    addAll(positions[i]);
+  positions.push_back(root);
+  std::ostringstream bytes;
+  full.write(bytes);
+  loadBook(bytes.str());
+  size_t complete = 0, reached = 0;
+  for (const Position &pos : positions) {
+    MoveList moves;
+    generateLegalMoves(pos, moves);
+    BookMoves found;
+    openingBook->probe(pos, moves, found);
+    bool inTree = pos.fullmoveNumber == 1 || pos.activeColor == BLACK;
+    reached += inTree;
+    complete += inTree && found.size() == moves.size();
+  }
+  check("positions of the first 2 plies", std::to_string(complete) + "/" + std::to_string(reached),
+        std::to_string(reached) + "/" + std::to_string(reached));
+  
+  openingBook.reset();
+  std::filesystem::remove(path);
+  println(failures, "failures");
+  return failures;
+}
+
+// Intent: Check every entry of a table against the values of its successors: a win needs a lost
+//         successor one ply shorter and none shorter, a loss needs only won successors and the
+//         longest one ply shorter, a draw neither
+// Pre: The table and its subtables are in endgames
+// Post: Return the number of entries that disagree
+size_t verifyTable(const TbTable &table) {
+  size_t wrong = 0;
+  for (size_t e = 0; e < table.size(); ++e) {
+    TbResult stored = table.at(e);
+    if (stored.wdl == TB_INVALID)
+      continue;
+    uint8_t squares[TB_MAX_PIECES];
+    Color stm;
+    table.unpack(e, squares, stm);
+    Position pos = table.position(squares, stm);
+    
+    MoveList moves;
+    generateLegalMoves(pos, moves);
+    unsigned shortestWin = 256, longestLoss = 0;
+    bool allWon = true;
+    for (const Move &m : moves) {
+      UndoInfo undo = makeMove(pos, m);
+      TbResult child{TB_DRAW, 0};
+      if (popCount(pos.occupied()) > 2)
+        endgames.probe(pos, child);
+      unmakeMove(pos, m, undo);
+      if (child.wdl == TB_LOSS)
+        shortestWin = std::min(shortestWin, child.dtm + 1u);
+      allWon = allWon && child.wdl == TB_WIN;
+      longestLoss = std::max(longestLoss, child.dtm + 1u);
+    }
+    
+    TbResult expected{TB_DRAW, 0};
+    if (!moves.size())
+      expected = pos.inCheck() ? TbResult{TB_LOSS, 0} : TbResult{TB_DRAW, 0};
+    else if (shortestWin < 256)
+      expected = {TB_WIN, uint8_t(shortestWin)};
+    else if (allWon)
+      expected = {TB_LOSS, uint8_t(longestLoss)};
+    wrong += stored.wdl != expected.wdl || stored.dtm != expected.dtm;
+  }
+  return wrong;
+}
+
+// Intent: Generate the tables of KQvK, KRvK, KPvK and KBNvK, check them entry by entry, against
+//         the known longest mates, the search, the mirrored positions and a saved copy
+// Pre: None
+// Post: Print each case, return the number of cases with an unexpected result
+size_t testTablebase() {
+  size_t failures = 0;
+  auto check = [&](const std::string &name, const std::string &result, const std::string &expected) {
+    failures += result != expected;
+    println(name + ":", result, result == expected ? "ok" : "FAILED");
+  };
+  
+  endgames = {};
+  std::map<std::string, unsigned> longest;
+  WorkerPool pool(std::max(std::thread::hardware_concurrency(), 1u));
+  for (const char *name : {"KQvK", "KRvK", "KPvK", "KBNvK"}) {
+    check("generate " + std::string(name), TB_STATUS_TEXT[endgames.generate(name, pool, [&](const TbTable &table, double) {
+      unsigned &mate = longest[table.name()];
+      for (size_t e = 0; e < table.size(); ++e)
+        mate = std::max(mate, table.at(e).wdl == TB_WIN ? unsigned(table.at(e).dtm) : 0u);
+    })], "ok");
+  }
+  check("unsupported material", TB_STATUS_TEXT[endgames.generate("KPvKP", pool)], "unsupported material");
+  check("tables", std::to_string(endgames.all().size()), "6");
+  for (const auto &table : endgames.all())
+    check("entries of " + table->name() + " that disagree", std::to_string(verifyTable(*table)), "0");
+  for (auto [name, plies] : {std::pair{"KQvK", 19u}, {"KRvK", 31u}, {"KBvK", 0u}, {"KNvK", 0u}, {"KBNvK", 65u}})
+    check("longest mate of " + std::string(name), std::to_string(longest[name]), std::to_string(plies));
+  
+  // the endings of the search benchmarks, seen from both colors
+  check("\"checkmate in 6\"", getTablebaseState("8/8/8/8/8/4K3/5Q2/7k w - - 11 56"), "White mates in 3");
+  check("rook & king", getTablebaseState("8/7K/8/8/8/8/R7/7k w - - 0 1"), "White mates in 8");
+  check("rook & king, colors swapped", getTablebaseState("7k/r7/8/8/8/8/7K/8 b - - 0 1"), "Black mates in 8");
+  check("opposition", getTablebaseState("8/8/8/4k3/8/4K3/4P3/8 w - - 0 1"), "Draw");
+  check("opposition, black to move", getTablebaseState("8/8/8/4k3/8/4K3/4P3/8 b - - 0 1"), "White mates in 20");
+  check("rook pawn", getTablebaseState("k7/8/K7/P7/8/8/8/8 w - - 0 1"), "Draw");
+  check("castling rights", getTablebaseState("8/8/8/8/8/2k5/8/R3K3 w Q - 0 1"), "");
+  check("five pieces", getTablebaseState("8/8/8/8/8/2k5/2p5/RR2K3 w - - 0 1"), "");
+  
+  // the search below the root only reads the tables, the mate scores have to agree
+  for (const char *fen : {"8/8/8/8/8/4K3/5Q2/7k w - - 11 56", "8/8/8/3k4/8/8/8/KBN5 w - - 0 1", "8/8/8/8/8/8/6k1/4K2R w - - 0 1"}) {
+    Position pos;
+    parseFEN(fen, pos);
+    TbResult root;
+    endgames.probe(pos, root);
+    TranspositionTable tt(16);
+    SearchResult result = search(pos, SearchLimits{.depth = 2}, tt, nullptr, &endgames);
+    check(std::string("search score of ") + fen, std::to_string(result.score), std::to_string(MATE - root.dtm));
+  }
+  
+  // mirrored placements share an entry, a saved table reads back the same
+  const TbTable &kbn = *endgames.all().back();
+  uint64_t random = 1;
+  size_t asymmetric = 0;
+  for (size_t i = 0; i < 100000; ++i) {
+    uint8_t squares[TB_MAX_PIECES], mirrored[TB_MAX_PIECES];
+    Color stm;
+    kbn.unpack(splitMix64(random) % kbn.size(), squares, stm);
+    if (!kbn.validEntry(kbn.entry(squares, stm), squares, stm))
+      continue;
+    unsigned symmetry = unsigned(splitMix64(random) % 8);
+    for (unsigned j = 0; j < kbn.count; ++j)
+      mirrored[j] = uint8_t(((symmetry & 4 ? (squares[j] & 7) << 3 | squares[j] >> 3 : squares[j]) ^ (symmetry & 1 ? 7 : 0)) ^ (symmetry & 2 ? 56 : 0));
+    asymmetric += kbn.entry(squares, stm) != kbn.entry(mirrored, stm);
+  }
+  check("mirrored placements with another entry", std::to_string(asymmetric), "0");
+  
+  std::stringstream file;
+  kbn.save(file);
+  Tablebase copy;
+  copy.load(file);
+  bool same = copy.all().size() == 1 && copy.all()[0]->name() == "KBNvK";
+  for (size_t e = 0; same && e < kbn.size(); ++e)
+    same = copy.all()[0]->at(e).wdl == kbn.at(e).wdl && copy.all()[0]->at(e).dtm == kbn.at(e).dtm;
+  check("saved and loaded KBNvK", same ? "same" : "different", "same");
+  
+  println(failures, "failures");
+  return failures;
+}
+
+// Intent: Play, take back and replay moves of a GameSession and compare its FEN and state
+// Pre: None
+// Post: Print each case, return the number of cases with an unexpected result
+size_t testSession() {
+  size_t failures = 0;
+  auto check = [&](const std::string &name, bool ok) {
+    failures += !ok;
+    println(name + ":", ok ? "ok" : "FAILED");
+  };
+  auto play = [](GameSession &session, const std::string &mov) {
+    CoordMove m;
+    return readMove(mov, m) == PARSE_OK && session.play(m.from, m.to, typeOf(m.promotion));
+  };
+  
+  GameSession session;
+  const std::string start = session.fen();
+  check("targets of e2", session.legalTargets(xy2sq(4, 6)) == (bit(xy2sq(4, 5)) | bit(xy2sq(4, 4))));
+  check("black cannot move first", !play(session, "e7e5"));
+  check("illegal move", !play(session, "e2e5"));
+  check("play e2e4", play(session, "e2e4") && session.fen() == getNextFEN(start, "e2e4"));
+  check("undo", session.undo() && session.fen() == start && !session.undo());
+  check("redo", session.redo() && session.fen() == getNextFEN(start, "e2e4") && !session.redo());
+  
+  // a move changes 2 to 4 squares, undo and redo the same ones
+  auto squares = [](std::initializer_list<const char *> crds) {
+    Bitboard result = 0;
+    for (const char *crd : crds)
+      result |= bit(xy2sq(crd[0] - 'a', '8' - crd[1]));
+    return result;
+  };
+  GameSession castling("r3k2r/8/8/3pP3/8/8/8/R3K2R w KQkq d6 0 1");
+  check("every square after load", castling.changedSquares() == ~Bitboard(0) && !castling.changedSquares());
+  check("changed by castling", play(castling, "e1g1") && castling.changedSquares() == squares({"e1", "f1", "g1", "h1"}));
+  check("changed by undo", castling.undo() && castling.changedSquares() == squares({"e1", "f1", "g1", "h1"}));
+  check("changed by en passant", play(castling, "e5d6") && castling.changedSquares() == squares({"e5", "d5", "d6"}));
+  check("board view", castling.board()[xy2sq(3, 2)] == W_PAWN && castling.board()[xy2sq(3, 3)] == NO_PIECE);
+  
+  // more plies than the key ring buffer holds: knight dances between pawn moves, then every
+  // state on the way back has to match a replay of the moves still played
+  std::vector<std::string> moves;
+  for (char file = 'a'; file <= 'h'; ++file) {
+    for (size_t i = 0; i < 16; ++i)
+      moves.push_back(std::array{"g1f3", "g8f6", "f3g1", "f6g8"}[i % 4]);
+    for (const char *push : {"2", "7", "3", "6"})
+      moves.push_back(file + std::string(push) + file + char(push[0] + (push[0] < '5' ? 1 : -1)));
+  }
+  session.load(start);
+  bool played = true, matched = true;
+  for (const std::string &mov : moves)
+    played = played && play(session, mov);
+  for (size_t n = moves.size(); n; --n) {
+    std::string prefix;
+    for (size_t i = 0; i < n; ++i)
+      prefix += moves[i] + ' ';
+    matched = matched && session.state() == getGameStateAfterMoves(start, prefix) && session.undo();
+  }
+  check("play " + std::to_string(moves.size()) + " plies", played);
+  check("state after each undo", matched && session.fen() == start);
+  
+  GameSession promotion("8/4P1k1/8/8/8/8/8/4K3 w - - 0 1");
+  check("promotion needs a piece", !play(promotion, "e7e8"));
+  check("pawn is no promotion", !promotion.play(xy2sq(4, 1), xy2sq(4, 0), PAWN));
+  check("promotion on a quiet move", !promotion.play(xy2sq(4, 7), xy2sq(4, 6), KNIGHT));
+  check("promotion to a knight", play(promotion, "e7e8N") && promotion.fen() == "4N3/6k1/8/8/8/8/8/4K3 b - - 0 1");
+  check("invalid FEN keeps the game", !promotion.load("8/8 w") && promotion.fen() == "4N3/6k1/8/8/8/8/8/4K3 b - - 0 1");
+  
+  println(failures, "failures");
+  return failures;
+}
+
+// Intent: Analyze a FEN/EPD file ("-" for stdin) line by line into out, or into stdout if out is empty
+// Pre: options.threads >= 1
+// Post: Print the throughput to stderr, return false if a file cannot be opened
+bool runBatch(const std::string &in, const std::string &out, const BatchOptions &options) {
+  std::ifstream inFile;
+  std::ofstream outFile;
+  if (in != "-" && (inFile.open(in), !inFile))
+    return false;
+  if (out.size() && (outFile.open(out), !outFile))
+    return false;
+  
+  BatchStats stats = analyzeBatch(in == "-" ? std::cin : inFile, out.size() ? outFile : std::cout, options);
+  std::cerr << stats.positions << " positions (" << stats.invalid << " invalid) in " << stats.seconds << " s, "
+            << uint64_t(stats.positions / stats.seconds) << " positions/s" << std::endl;
+  return true;
+}
+
+// Intent: Replay every game of a PGN file ("-" for stdin) and report the games that fail
+// Pre: threads >= 1
+// Post: Print one line per failing game, or per game with its final FEN if printFEN is set,
+//       print the throughput to stderr, return false if the file cannot be opened
+bool runPgn(const std::string &in, unsigned threads, bool printFEN) {
+  std::ifstream inFile;
+  if (in != "-" && (inFile.open(in), !inFile))
+    return false;
+  
+  WorkerPool pool(threads);
+  PgnStats stats = validatePgn(in == "-" ? std::cin : inFile, pool, 1024, [&](const GameReport &report) {
+    if (report.error)
+      std::cout << "game " << report.index << ", ply " << report.plies + 1 << ": " << PGN_ERROR_TEXT[report.error]
+                << " \"" << report.token << "\"\n";
+    else if (printFEN)
+      std::cout << "game " << report.index << ": " << data2fen(report.final) << '\n';
+  });
+  std::cout.flush();
+  std::cerr << stats.games << " games (" << stats.invalid << " invalid), " << stats.plies << " plies in "
+            << stats.seconds << " s, " << uint64_t(stats.games / stats.seconds) << " games/s, "
+            << uint64_t(stats.plies / stats.seconds) << " plies/s" << std::endl;
+  return true;
+}
+
+// Intent: Play random games and write their positions to a file ("-" for stdout)
+// Pre: options.threads >= 1
+// Post: Print the throughput to stderr, return false if the file cannot be opened
+bool runSelfPlay(const std::string &out, const SelfPlayOptions &options) {
+  std::ofstream outFile;
+  if (out != "-" && (outFile.open(out, std::ios::binary), !outFile))
+    return false;
+  
+  auto start = std::chrono::steady_clock::now();
+  SelfPlay selfPlay(options, [](const Position &pos, std::string &line) { line += data2fen(pos); });
+  SelfPlayReport report = selfPlay.run(out == "-" ? std::cout : outFile);
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  std::cerr << report.games << " games (" << report.results[WHITE_WINS] << " 1-0, " << report.results[BLACK_WINS]
+            << " 0-1, " << report.results[GAME_DRAWN] << " drawn), " << report.positions << " positions, "
+            << report.bytes << " bytes in " << seconds << " s, " << uint64_t(report.games / seconds) << " games/s, "
+            << uint64_t(report.positions / seconds) << " positions/s" << std::endl;
+  return true;
+}
+
+// Intent: Play the same games on 1 and 3 threads and check that the records match, that
+//         every record unpacks to a position whose FEN reads back to the same key, and that
+//         the last position of every game is over for the reason its result says
+// Pre: None
+// Post: Return the number of failures
+size_t testSelfPlay() {
+  size_t failures = 0;
+  auto check = [&](const std::string &name, bool ok) {
+    failures += !ok;
+    println(name + ":", ok ? "ok" : "FAILED");
+  };
+  
+  auto play = [](unsigned threads, SelfPlayFormat format, SelfPlayReport &report) {
+    std::ostringstream out;
+    SelfPlay selfPlay({.games = 200, .threads = threads, .seed = 7, .captureBias = 25, .format = format},
+                      [](const Position &pos, std::string &line) { line += data2fen(pos); });
+    report = selfPlay.run(out);
+    return out.str();
+  };
+  auto sortedRecords = [](const std::string &bytes) {
+    std::vector<std::string> records;
+    for (size_t i = 0; i + sizeof(PositionRecord) <= bytes.size(); i += sizeof(PositionRecord))
+      records.push_back(bytes.substr(i, sizeof(PositionRecord)));
+    std::sort(records.begin(), records.end());
+    return records;
+  };
+  
+  SelfPlayReport single, multi, text;
+  std::string bytes = play(1, SELFPLAY_BINARY, single);
+  check("record size", bytes.size() == single.positions * sizeof(PositionRecord) && single.bytes == bytes.size());
+  check("results add up", single.results[0] + single.results[1] + single.results[2] == 200);
+  check("same games on 3 threads", sortedRecords(play(3, SELFPLAY_BINARY, multi)) == sortedRecords(bytes));
+  
+  size_t unpacked = 0, keys = 0, endings = 0, games = 0;
+  for (size_t i = 0; i < bytes.size(); i += sizeof(PositionRecord)) {
+    PositionRecord record;
+    std::memcpy(record.bytes, bytes.data() + i, sizeof(record.bytes));
+    Position pos, read;
+    GameResult result;
+    if (!unpackPosition(record, pos, result))
+      continue;
+    ++unpacked;
+    keys += parseFEN(data2fen(pos), read) && read.key == pos.key;
+    if (record.bytes[31])
+      continue;
+    
+    // the last position of a game, a draw by repetition cannot be told from the position alone
+    ++games;
+    bool mate = !hasAnyLegalMove(pos) && pos.inCheck();
+    if (result == GAME_DRAWN)
+      endings += !mate;
+    else
+      endings += mate && result == (pos.activeColor == WHITE ? BLACK_WINS : WHITE_WINS);
+  }
+  size_t positions = bytes.size() / sizeof(PositionRecord);
+  check("every record unpacks", unpacked == positions);
+  check("keys of the FENs", keys == positions);
+  check("game endings", games == 200 && endings == 200);
+  
+  std::string lines = play(2, SELFPLAY_FEN, text);
+  check("FEN lines", size_t(std::count(lines.begin(), lines.end(), '\n')) == single.positions
+                     && text.results[WHITE_WINS] == single.results[WHITE_WINS]);
+  
+  println(failures, "failures");
+  return failures;
+}
+
+// Intent: Write a book of the moves played in the first plies plies of the games of a PGN file
+// Pre: None
+// Post: Return false if a file cannot be opened, games are counted up to their first bad move
+bool makeBook(const std::string &in, const std::string &out, unsigned plies) {
+  std::ifstream inFile;
+  if (in != "-" && (inFile.open(in), !inFile))
+    return false;
+  std::ofstream outFile(out, std::ios::binary);
+  if (!outFile)
+    return false;
+  
+  // one worker, the writer is not shared between threads
+  WorkerPool pool(1);
+  BookWriter writer;
+  PgnStats stats = validatePgn(in == "-" ? std::cin : inFile, pool, 1024, [](const GameReport &) {},
+                               [&](const Position &pos, Move m, uint32_t ply) {
+    if (ply < plies)
+      writer.add(pos, m);
+  });
+  size_t entries = writer.write(outFile);
+  std::cerr << stats.games << " games (" << stats.invalid << " invalid), " << entries << " entries written to "
+            << out << std::endl;
+  return bool(outFile);
+}
+
+// Intent: Generate tables and print the time, the size and the outcomes of each
+// Pre: threads >= 1
+// Post: Return false if a name is unsupported or a file cannot be written, the tables are
+//       written to dir as <name>.ctb if dir is not empty
+bool generateTables(const std::vector<std::string> &names, unsigned threads, const std::string &dir) {
+  WorkerPool pool(threads);
+  bool written = true;
+  auto report = [&](const TbTable &table, double seconds) {
+    size_t counts[4] = {};
+    unsigned longest = 0;
+    for (size_t e = 0; e < table.size(); ++e) {
+      TbResult result = table.at(e);
+      ++counts[result.wdl];
+      longest = std::max(longest, result.wdl == TB_WIN ? unsigned(result.dtm) : 0u);
+    }
+    std::cout << table.name() << ": " << seconds << " s, " << uint64_t(table.size() / seconds) << " entries/s, "
+              << counts[TB_WIN] << " won, " << counts[TB_DRAW] << " drawn, " << counts[TB_LOSS] << " lost, "
+              << counts[TB_INVALID] << " invalid, longest mate " << longest << " plies" << std::endl;
+    if (dir.size()) {
+      std::ofstream out(std::filesystem::path(dir) / (table.name() + ".ctb"), std::ios::binary);
+      table.save(out);
+      written = written && out;
+    }
+  };
+  
+  auto start = std::chrono::steady_clock::now();
+  for (const std::string &name : names) {
+    if (TbStatus status = endgames.generate(name, pool, report)) {
+      println(name + ":", TB_STATUS_TEXT[status]);
+      return false;
+    }
+  }
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  println(endgames.all().size(), "tables with", threads, "threads in", seconds, "s");
+  return written;
+}
+
+// Intent: Print the tablebase value of a position and the time of one probe, the tables are
+//         read from the .ctb files of dir, or generated if dir is empty
+// Pre: None
+// Post: Return false if the FEN is invalid or no table holds the position
+bool probeTables(const std::string &fen, const std::string &dir) {
+  Position pos;
+  if (!parseFEN(fen, pos))
+    return false;
+  
+  if (dir.size()) {
+    for (const auto &file : std::filesystem::directory_iterator(dir)) {
+      if (file.path().extension() != ".ctb")
+        continue;
+      std::ifstream in(file.path(), std::ios::binary);
+      if (TbStatus status = endgames.load(in))
+        println(file.path().string() + ":", TB_STATUS_TEXT[status]);
+    }
+  } else {
+    std::string sides[2];
+    for (uint8_t sq = 0; sq < 64; ++sq)
+      if (pos.board[sq])
+        sides[colorOf(pos.board[sq])] += PIECE_CHARS[makePiece(WHITE, typeOf(pos.board[sq]))];
+    WorkerPool pool(std::max(std::thread::hardware_concurrency(), 1u));
+    endgames.generate(tablebaseName(sides[WHITE], sides[BLACK]), pool);
+  }
+  
+  TbResult result;
+  if (!endgames.probe(pos, result)) {
+    println("no table holds", fen);
+    return false;
+  }
+  println(fen + ":", std::array{"draw", "win", "loss", "invalid"}[result.wdl], "in", unsigned(result.dtm), "plies,",
+          getTablebaseState(fen));
+  
+  constexpr size_t iterations = 1000000;
+  auto start = std::chrono::steady_clock::now();
+  for (size_t i = 0; i < iterations; ++i) {
+    endgames.probe(pos, result);
+    volatile uint8_t sink = result.dtm;
+    (void)sink;
+  }
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  println("probe:", seconds / iterations * 1e9, "ns");
+  return true;
+}
+
+// Intent: Print the counters and the timed functions that were called, with their mean time
+// Pre: None
+// Post: None
+void printStats(const Stats &stats) {
+  for (unsigned i = 0; i < STAT_COUNTERS; ++i)
+    println(std::string(STAT_COUNTER_NAMES[i]) + ":", stats.counters[i]);
+  for (unsigned f = 0; f < STAT_FUNCTIONS; ++f)
+    if (auto [calls, nanoseconds] = stats.functions[f]; calls)
+      println(std::string(STAT_FUNCTION_NAMES[f]) + ":", calls, "calls,", nanoseconds / 1e6, "ms,",
+              nanoseconds / calls, "ns per call");
+}
+
+// Intent: Call the exported functions on the test positions and search with two threads,
+//         then print the counters and check that resetStats zeroes them
+// Pre: None
+// Post: Return false if the build has no stats or a counter does not add up
+bool runStats() {
+  if (!getStats().enabled) {
+    println("built without -DENABLE_STATS, every counter is compiled out");
+    return false;
+  }
+  
+  resetStats();
+  for (const auto &[name, fen, perft] : TEST_POSITIONS) {
+    getGameState(fen);
+    getLegalMoves(fen);
+    getValidTargetSquares(fen, "e2");
+  }
+  getBestMove(INITIAL_FEN, "depth 5 threads 2");
+  GameSession session;
+  session.play(52, 36, 0);
+  session.undo();
+  
+  Stats stats = getStats();
+  printStats(stats);
+  bool ok = stats.counters[STAT_FEN_PARSES] >= 3 * std::size(TEST_POSITIONS) + 2
+         && stats.counters[STAT_NODES] && stats.counters[STAT_MAKE_MOVES] == stats.counters[STAT_UNMAKE_MOVES]
+         && stats.counters[STAT_TT_HITS] && stats.counters[STAT_TT_STORES] >= stats.counters[STAT_TT_COLLISIONS]
+         && stats.functions[FN_GET_LEGAL_MOVES].calls == std::size(TEST_POSITIONS)
+         && stats.functions[FN_SESSION_UNDO].calls == 1;
+  
+  resetStats();
+  stats = getStats();
+  ok = ok && std::all_of(stats.counters.begin(), stats.counters.end(), [](uint64_t c) { return !c; })
+          && std::all_of(stats.functions.begin(), stats.functions.end(), [](FunctionStats f) { return !f.calls; });
+  println(ok ? "stats: ok" : "stats: FAILED");
+  return ok;
+}
+
+// Intent: Print the book moves of a position and the time of one probe
+// Pre: None
+// Post: Return false if the book cannot be opened or the FEN is invalid
+bool probeBook(const std::string &path, const std::string &fen) {
+  if (BookStatus status = Book::open(path, openingBook)) {
+    println(path + ":", BOOK_STATUS_TEXT[status]);
+    return false;
+  }
+  Position pos;
+  if (!parseFEN(fen, pos))
+    return false;
+  
+  MoveList moves;
+  generateLegalMoves(pos, moves);
+  BookMoves found;
+  openingBook->probe(pos, moves, found);
+  println(openingBook->size(), "entries,", found.size(), "book moves in", fen);
+  for (const BookMove &m : found)
+    println(move2crd(m.move, pos.activeColor), m.weight);
+  
+  // probes of an opening position only, the move generation of the caller is not timed
+  constexpr size_t iterations = 1000000;
+  size_t hits = 0;
+  auto start = std::chrono::steady_clock::now();
+  for (size_t i = 0; i < iterations; ++i) {
+    openingBook->probe(pos, moves, found);
+    hits += found.size();
+  }
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  println("probe:", seconds / iterations * 1e6, "us", hits ? "" : "(miss)");
+  return true;
+}
+
+int main(int argc, char *argv[]) {
+  std::vector<std::string> args(argv + 1, argv + argc);
+  
+  if (args.size() && args[0] == "bench-parse") {
+    benchmarkParser(args.size() > 1 ? std::stoul(args[1]) : 100000);
+    return 0;
+  }
+  
+  if (args.size() && args[0] == "test-fen")
+    return testFen(args.size() > 1 ? std::stoul(args[1]) : 200000) ? 1 : 0;
+  
+  if (args.size() && args[0] == "bench-targets")
+    return benchmarkTargets(args.size() > 1 ? std::stoul(args[1]) : 1000) ? 1 : 0;
+  
+  if (args.size() && args[0] == "bench-api") {
+    bool json = std::erase(args, "--json");
+    std::string baseline;
+    double threshold = 10;
+    size_t samples = 101;
+    for (size_t i = 1; i + 1 < args.size(); i += 2) {
+      if (args[i] == "--compare")
+        baseline = args[i + 1];
+      else if (args[i] == "--threshold")
+        threshold = std::stod(args[i + 1]);
+      else if (args[i] == "--samples")
+        samples = std::max(std::stoul(args[i + 1]), 1ul);
+    }
+    int regressions = runApiBenchmarks(samples, json, baseline, threshold);
+    return regressions < 0 ? 2 : regressions ? 1 : 0;
+  }
+  
+  if (args.size() && args[0] == "perft") {
+    bool json = std::erase(args, "--json");
+    size_t hashMB = 0;
+    if (auto it = std::find(args.begin(), args.end(), "--hash"); it != args.end() && it + 1 != args.end()) {
+      hashMB = std::stoul(it[1]);
+      args.erase(it, it + 2);
+    }
+    unsigned depth = args.size() > 1 ? std::stoul(args[1]) : 4;
+    if (depth < 1 || depth > MAX_PERFT_DEPTH) {
+      println("depth has to be between 1 and", MAX_PERFT_DEPTH);
+      return 2;
+    }
+    return runPerft(depth, json, hashMB) ? 1 : 0;
+  }
+  
+  if (args.size() && args[0] == "bench-search") {
+    unsigned threads = 1;
+    if (auto it = std::find(args.begin(), args.end(), "--threads"); it != args.end() && it + 1 != args.end()) {
+      threads = std::max(std::stoul(it[1]), 1ul);
+      args.erase(it, it + 2);
+    }
+    std::unique_ptr<Network> network;
+    if (auto it = std::find(args.begin(), args.end(), "--nnue"); it != args.end() && it + 1 != args.end()) {
+      if (NnueStatus status = loadNetworkFile(it[1], network)) {
+        println(it[1] + ":", NNUE_STATUS_TEXT[status]);
+        return 2;
+      }
+      args.erase(it, it + 2);
+    }
+    benchmarkSearch(args.size() > 1 ? std::stoul(args[1]) : 5, threads, 16, network.get());
+    return 0;
+  }
+  
+  if (args.size() && args[0] == "nnue-bench") {
+    std::unique_ptr<Network> network;
+    if (NnueStatus status = loadNetworkFile(args.size() > 1 ? args[1] : "pst", network)) {
+      println(args[1] + ":", NNUE_STATUS_TEXT[status]);
+      return 2;
+    }
+    return benchmarkNnue(*network, args.size() > 2 ? std::stoul(args[2]) : 200) ? 1 : 0;
+  }
+  
+  if (args.size() > 1 && args[0] == "nnue-export") {
+    std::ofstream out(args[1], std::ios::binary);
+    Network::fromPieceSquareTables()->save(out);
+    return out ? 0 : 2;
+  }
+  
+  if (args.size() && args[0] == "bench-ordering")
+    return benchmarkOrdering(args.size() > 1 ? std::stoul(args[1]) : 6, 64) ? 0 : 1;
+  
+  if (args.size() && args[0] == "test-see")
+    return testSee() ? 1 : 0;
+  
+  if (args.size() && args[0] == "bench-threads") {
+    benchmarkThreads(args.size() > 1 ? std::stoul(args[1]) : 7, 64);
+    return 0;
+  }
+  
+  if (args.size() > 1 && args[0] == "batch") {
+    BatchOptions options{.threads = std::max(std::thread::hardware_concurrency(), 1u)};
+    std::string out;
+    for (size_t i = 2; i + 1 < args.size(); i += 2) {
+      if (args[i] == "--threads")
+        options.threads = std::max(std::stoul(args[i + 1]), 1ul);
+      else if (args[i] == "--depth")
+        options.depth = std::stoul(args[i + 1]);
+      else if (args[i] == "-o")
+        out = args[i + 1];
+    }
+    return runBatch(args[1], out, options) ? 0 : 2;
+  }
+  
+  if (args.size() > 1 && args[0] == "pgn") {
+    bool printFEN = std::erase(args, "--fen");
+    unsigned threads = std::max(std::thread::hardware_concurrency(), 1u);
+    if (auto it = std::find(args.begin(), args.end(), "--threads"); it != args.end() && it + 1 != args.end()) {
+      threads = std::max(std::stoul(it[1]), 1ul);
+      args.erase(it, it + 2);
+    }
+    return runPgn(args[1], threads, printFEN) ? 0 : 2;
+  }
+  
+  if (args.size() && args[0] == "test-search")
+    return testSearch() ? 1 : 0;
+  
+  if (args.size() && args[0] == "test-draws")
+    return testDraws() ? 1 : 0;
+  
+  if (args.size() && args[0] == "test-session")
+    return testSession() ? 1 : 0;
+  
+  if (args.size() && args[0] == "test-book")
+    return testBook() ? 1 : 0;
+  
+  if (args.size() && args[0] == "test-tablebase")
+    return testTablebase() ? 1 : 0;
+  
+  if (args.size() && args[0] == "tb-gen") {
+    unsigned threads = std::max(std::thread::hardware_concurrency(), 1u);
+    std::string dir;
+    if (auto it = std::find(args.begin(), args.end(), "--threads"); it != args.end() && it + 1 != args.end()) {
+      threads = std::max(std::stoul(it[1]), 1ul);
+      args.erase(it, it + 2);
+    }
+    if (auto it = std::find(args.begin(), args.end(), "-o"); it != args.end() && it + 1 != args.end()) {
+      dir = it[1];
+      args.erase(it, it + 2);
+    }
+    std::vector<std::string> names(args.begin() + 1, args.end());
+    if (names.empty())
+      names = {"KQvK", "KRvK", "KPvK", "KBNvK", "KQvKR"};
+    return generateTables(names, threads, dir) ? 0 : 2;
+  }
+  
+  if (args.size() > 1 && args[0] == "tb-probe")
+    return probeTables(args[1], args.size() > 2 ? args[2] : "") ? 0 : 2;
+  
+  if (args.size() > 2 && args[0] == "book-make") {
+    unsigned plies = BOOK_PLIES;
+    if (auto it = std::find(args.begin(), args.end(), "--plies"); it != args.end() && it + 1 != args.end()) {
+      plies = std::stoul(it[1]);
+      args.erase(it, it + 2);
+    }
+    return makeBook(args[1], args[2], plies) ? 0 : 2;
+  }
+  
+  if (args.size() && args[0] == "stats")
+    return runStats() ? 0 : 1;
+  
+  if (args.size() && args[0] == "test-selfplay")
+    return testSelfPlay() ? 1 : 0;
+  
+  if (args.size() > 1 && args[0] == "selfplay") {
+    SelfPlayOptions options;
+    options.threads = std::max(std::thread::hardware_concurrency(), 1u);
+    options.format = std::erase(args, "--fen") ? SELFPLAY_FEN : SELFPLAY_BINARY;
+    for (size_t i = 2; i + 1 < args.size(); i += 2) {
+      if (args[i] == "--games")
+        options.games = std::stoull(args[i + 1]);
+      else if (args[i] == "--threads")
+        options.threads = std::max(std::stoul(args[i + 1]), 1ul);
+      else if (args[i] == "--seed")
+        options.seed = std::stoull(args[i + 1]);
+      else if (args[i] == "--captures")
+        options.captureBias = std::min(std::stoul(args[i + 1]), 100ul);
+    }
+    return runSelfPlay(args[1], options) ? 0 : 2;
+  }
+  
+  if (args.size() > 1 && args[0] == "book")
+    return probeBook(args[1], args.size() > 2 ? args[2] : INITIAL_FEN) ? 0 : 2;
+  
+  if (args.size() && args[0] == "verify-keys")
+    return verifyKeys(args.size() > 1 ? std::stoul(args[1]) : 3) ? 1 : 0;
+  
+  if (args.size() > 2 && args[0] == "divide")
+    return runDivide(std::stoul(args[1]), args[2]) ? 0 : 2;
+  
   println("===== TEST (module.cpp) =====");
   println();
   
@@ -0,0 +1,351 @@
+/***************************************************************************
+ * File: movegen.h
+ * Author: 朱昱綸 (B11115022@mail.ntust.edu.tw)
+ *         張庭嘉 (B11115027@mail.ntust.edu.tw)
+ *         顏毓德 (B11115038@mail.ntust.edu.tw)
+ *         黃雋祐 (B11115048@mail.ntust.edu.tw)
+ * Create Date: Oct 16, 2026
+ * Update Date: Oct 16, 2026
+ * Description: Bitboard legal move generation on Position. (C++20)
+***************************************************************************/
+// Include guard
+#pragma once
+
+// Necessary headers
+#include "position.h"
+#include "stats.h"
+
+// Special move kinds stored in bits 12-13 of Move::data
+enum MoveFlag : uint16_t { NORMAL = 0, PROMOTION = 1 << 12, EN_PASSANT = 2 << 12, CASTLING = 3 << 12 };
+
+// A move packed into 16 bits: source square (bits 0-5), target square (bits 6-11),
+// MoveFlag (bits 12-13) and the promotion type counted from KNIGHT (bits 14-15)
+struct Move {
+  uint16_t data;
+
+  constexpr uint8_t from() const { return data & 63; }
+  constexpr uint8_t to() const { return (data >> 6) & 63; }
+  constexpr MoveFlag flag() const { return MoveFlag(data & (3 << 12)); }
+  constexpr PieceType promotionType() const { return PieceType(KNIGHT + (data >> 14)); }
+  constexpr bool operator==(const Move &rhs) const = default;
+};
+
+// Intent: Pack a move into a Move
+// Pre: from <= 63 && to <= 63, KNIGHT <= promotion <= QUEEN
+// Post: None
+constexpr Move encodeMove(uint8_t from, uint8_t to, MoveFlag flag = NORMAL, PieceType promotion = KNIGHT) {
+  return Move{uint16_t(from | (to << 6) | flag | ((promotion - KNIGHT) << 14))};
+}
+
+// Game positions have at most 218 legal moves, but FENs with many extra queens can go past 256
+constexpr size_t MAX_MOVES = 512;
+
+// Fixed-capacity move list that lives on the stack
+struct MoveList {
+  Move moves[MAX_MOVES];
+  size_t count = 0;
+
+  void push(Move m) { moves[count++] = m; }
+  size_t size() const { return count; }
+  const Move *begin() const { return moves; }
+  const Move *end() const { return moves + count; }
+  const Move &operator[](size_t i) const { return moves[i]; }
+};
+
+// Squares of the king and the rooks before castling, and the squares that have to be
+// empty or safe, indexed by [Color][0 == kingside, 1 == queenside]
+struct CastlingPath {
+  uint8_t right;
+  uint8_t kingFrom;
+  uint8_t kingTo;
+  uint8_t rookFrom;
+  uint8_t rookTo;
+  Bitboard empty;  // squares between the king and the rook
+  Bitboard safe;   // squares the king starts on, passes and lands on
+};
+
+constexpr CastlingPath CASTLING_PATHS[2][2] = {
+  {{WHITE_OO, 60, 62, 63, 61, bit(61) | bit(62), bit(60) | bit(61) | bit(62)},
+   {WHITE_OOO, 60, 58, 56, 59, bit(57) | bit(58) | bit(59), bit(60) | bit(59) | bit(58)}},
+  {{BLACK_OO, 4, 6, 7, 5, bit(5) | bit(6), bit(4) | bit(5) | bit(6)},
+   {BLACK_OOO, 4, 2, 0, 3, bit(1) | bit(2) | bit(3), bit(4) | bit(3) | bit(2)}},
+};
+
+// Castling rights kept after a move touches a square, indexed by square
+constexpr auto CASTLING_MASK = [] {
+  std::array<uint8_t, 64> mask{};
+  mask.fill(WHITE_OO | WHITE_OOO | BLACK_OO | BLACK_OOO);
+  for (const auto &paths : CASTLING_PATHS) {
+    for (const CastlingPath &path : paths) {
+      mask[path.kingFrom] &= ~path.right;
+      mask[path.rookFrom] &= ~path.right;
+    }
+  }
+  return mask;
+}();
+
+// Intent: Get the square of the pawn removed by an en passant capture onto pos.enPassant
+// Pre: pos.enPassant != NO_SQUARE
+// Post: None
+inline uint8_t enPassantVictim(const Position &pos) {
+  return pos.activeColor == WHITE ? pos.enPassant + 8 : pos.enPassant - 8;
+}
+
+// What the side to move has to respect, computed once per position
+struct CheckInfo {
+  Bitboard checkers;   // enemy pieces giving check
+  Bitboard pinned;     // own pieces that may only move along the line to their king
+  Bitboard checkMask;  // squares that capture the single checker or block it, every square if not in check
+  Bitboard kingDanger; // squares attacked by the enemy, sliders see through our king
+};
+
+// Intent: Get every square attacked by the pieces of one color
+// Pre: None
+// Post: None
+inline Bitboard attackedBy(const Position &pos, Color c, Bitboard occupied) {
+  Bitboard pawns = pos.pieces(c, PAWN);
+  Bitboard result = c == WHITE ? shiftNorth(shiftEast(pawns) | shiftWest(pawns)) : shiftSouth(shiftEast(pawns) | shiftWest(pawns));
+  for (Bitboard b = pos.pieces(c, KNIGHT); b; )
+    result |= KNIGHT_ATTACKS[popLsb(b)];
+  for (Bitboard b = pos.byColor[c] & (pos.byType[BISHOP] | pos.byType[QUEEN]); b; )
+    result |= bishopAttacks(popLsb(b), occupied);
+  for (Bitboard b = pos.byColor[c] & (pos.byType[ROOK] | pos.byType[QUEEN]); b; )
+    result |= rookAttacks(popLsb(b), occupied);
+  return result | KING_ATTACKS[pos.kingSquare[c]];
+}
+
+// Intent: Find the checkers, the pinned pieces and the squares the king must avoid
+// Pre: None
+// Post: None
+inline CheckInfo computeCheckInfo(const Position &pos) {
+  Color us = pos.activeColor, them = Color(!us);
+  uint8_t king = pos.kingSquare[us];
+  Bitboard occupied = pos.occupied();
+  CheckInfo info{};
+
+  STAT_COUNT(STAT_ATTACK_CHECKS);
+  info.checkers = pos.attackersTo(king, occupied) & pos.byColor[them];
+  info.checkMask = ~Bitboard(0);
+  if (info.checkers)
+    info.checkMask = info.checkers | BETWEEN[king][lsb(info.checkers)];
+
+  // an enemy slider that sees the king through exactly one own piece pins it
+  Bitboard snipers = (bishopAttacks(king, 0) & (pos.byType[BISHOP] | pos.byType[QUEEN]))
+                   | (rookAttacks(king, 0) & (pos.byType[ROOK] | pos.byType[QUEEN]));
+  for (snipers &= pos.byColor[them]; snipers; ) {
+    Bitboard blockers = BETWEEN[king][popLsb(snipers)] & occupied;
+    if (popCount(blockers) == 1)
+      info.pinned |= blockers & pos.byColor[us];
+  }
+
+  info.kingDanger = attackedBy(pos, them, occupied ^ bit(king));
+  return info;
+}
+
+// Intent: Check if an en passant capture from `from` leaves the king safe, the only move
+//         that removes two pieces from a line and therefore escapes the pin and check masks
+// Pre: pos.enPassant != NO_SQUARE and the pawn on `from` attacks it
+// Post: None
+inline bool isLegalEnPassant(const Position &pos, uint8_t from) {
+  Color us = pos.activeColor;
+  uint8_t victim = enPassantVictim(pos);
+  STAT_COUNT(STAT_ATTACK_CHECKS);
+  Bitboard occupied = (pos.occupied() ^ bit(from) ^ bit(victim)) | bit(pos.enPassant);
+  return !(pos.attackersTo(pos.kingSquare[us], occupied) & pos.byColor[!us] & ~bit(victim));
+}
+
+// Intent: Get the squares the piece on `from` can legally move to
+// Pre: info == computeCheckInfo(pos)
+// Post: result == 0 if `from` is empty or holds a piece of the side not to move
+inline Bitboard legalTargets(const Position &pos, uint8_t from, const CheckInfo &info) {
+  Color us = pos.activeColor;
+  Piece piece = pos.board[from];
+  if (piece == NO_PIECE || colorOf(piece) != us)
+    return 0;
+
+  Bitboard occupied = pos.occupied();
+  Bitboard notOwn = ~pos.byColor[us];
+
+  if (typeOf(piece) == KING) {
+    Bitboard targets = KING_ATTACKS[from] & notOwn & ~info.kingDanger;
+    for (const CastlingPath &path : CASTLING_PATHS[us]) {
+      if ((pos.castlingRights & path.right) && from == path.kingFrom && pos.board[path.rookFrom] == makePiece(us, ROOK)
+          && !(occupied & path.empty) && !(info.kingDanger & path.safe))
+        targets |= bit(path.kingTo);
+    }
+    return targets;
+  }
+
+  // only the king can escape a double check
+  if (popCount(info.checkers) > 1)
+    return 0;
+
+  Bitboard targets = 0;
+  switch (typeOf(piece)) {
+    case PAWN: {
+      Bitboard b = bit(from);
+      Bitboard single = (us == WHITE ? shiftNorth(b) : shiftSouth(b)) & ~occupied;
+      Bitboard doubled = (us == WHITE ? shiftNorth(single & rowBB(5)) : shiftSouth(single & rowBB(2))) & ~occupied;
+      targets = single | doubled | (PAWN_ATTACKS[us][from] & pos.byColor[!us]);
+      break;
+    }
+    case KNIGHT:
+      targets = KNIGHT_ATTACKS[from] & notOwn;
+      break;
+    case BISHOP:
+      targets = bishopAttacks(from, occupied) & notOwn;
+      break;
+    case ROOK:
+      targets = rookAttacks(from, occupied) & notOwn;
+      break;
+    case QUEEN:
+      targets = (bishopAttacks(from, occupied) | rookAttacks(from, occupied)) & notOwn;
+      break;
+    default:
+      break;
+  }
+
+  targets &= info.checkMask;
+  if (info.pinned & bit(from))
+    targets &= LINE[pos.kingSquare[us]][from];
+
+  if (typeOf(piece) == PAWN && pos.enPassant != NO_SQUARE && (PAWN_ATTACKS[us][from] & bit(pos.enPassant))
+      && !(occupied & bit(pos.enPassant)) && pos.board[enPassantVictim(pos)] == makePiece(Color(!us), PAWN)
+      && isLegalEnPassant(pos, from))
+    targets |= bit(pos.enPassant);
+
+  return targets;
+}
+
+// Intent: Get the squares the piece on `from` can legally move to
+// Pre: None
+// Post: result == 0 if `from` is empty or holds a piece of the side not to move
+inline Bitboard legalTargets(const Position &pos, uint8_t from) {
+  return legalTargets(pos, from, computeCheckInfo(pos));
+}
+
+// Intent: Append every legal move of the side to move to list
+// Pre: None
+// Post: Promotions are listed once per promotion type, from queen to knight
+inline void generateLegalMoves(const Position &pos, MoveList &list) {
+  Color us = pos.activeColor;
+  Bitboard lastRow = rowBB(us == WHITE ? 0 : 7);
+  CheckInfo info = computeCheckInfo(pos);
+
+  for (Bitboard pieces = pos.byColor[us]; pieces; ) {
+    uint8_t from = popLsb(pieces);
+    PieceType type = typeOf(pos.board[from]);
+
+    for (Bitboard targets = legalTargets(pos, from, info); targets; ) {
+      uint8_t to = popLsb(targets);
+      if (type == PAWN && (bit(to) & lastRow)) {
+        for (PieceType promotion : {QUEEN, ROOK, BISHOP, KNIGHT})
+          list.push(encodeMove(from, to, PROMOTION, promotion));
+      } else if (type == PAWN && to == pos.enPassant && (PAWN_ATTACKS[us][from] & bit(to))) {
+        list.push(encodeMove(from, to, EN_PASSANT));
+      } else if (type == KING && (to == from + 2 || to + 2 == from)) {
+        list.push(encodeMove(from, to, CASTLING));
+      } else {
+        list.push(encodeMove(from, to));
+      }
+    }
+  }
+}
+
+// Intent: Check if the side to move has at least one legal move, stopping at the first one found
+// Pre: None
+// Post: None
+inline bool hasAnyLegalMove(const Position &pos) {
+  CheckInfo info = computeCheckInfo(pos);
+  for (Bitboard pieces = pos.byColor[pos.activeColor]; pieces; )
+    if (legalTargets(pos, popLsb(pieces), info))
+      return true;
+  return false;
+}
+
+// State that makeMove cannot recover from the move itself
+struct UndoInfo {
+  Piece captured;          // NO_PIECE if the move is not a capture
+  uint8_t castlingRights;
+  uint8_t enPassant;
+  uint16_t halfmoveClock;
+  uint64_t key;
+};
+
+// Intent: Play a move on pos in place
+// Pre: m was generated by generateLegalMoves for pos, or at least moves a piece of the side to move
+// Post: pos is the position after the move and pos.key its hash, the returned record lets unmakeMove restore it
+inline UndoInfo makeMove(Position &pos, Move m) {
+  STAT_COUNT(STAT_MAKE_MOVES);
+  Color us = pos.activeColor;
+  uint8_t from = m.from(), to = m.to();
+  Piece piece = pos.board[from];
+  UndoInfo undo{pos.board[to], pos.castlingRights, pos.enPassant, pos.halfmoveClock, pos.key};
+
+  if (m.flag() == EN_PASSANT) {
+    undo.captured = pos.board[enPassantVictim(pos)];
+    pos.remove(enPassantVictim(pos));
+  } else if (undo.captured != NO_PIECE) {
+    pos.remove(to);
+  }
+
+  // reset or increment the halfmove clock
+  pos.halfmoveClock = (typeOf(piece) == PAWN || undo.captured != NO_PIECE) ? 0 : pos.halfmoveClock + 1;
+
+  // move and promote the piece
+  pos.remove(from);
+  pos.put(to, m.flag() == PROMOTION ? makePiece(us, m.promotionType()) : piece);
+
+  // move the rook when castling
+  if (m.flag() == CASTLING) {
+    const CastlingPath &path = CASTLING_PATHS[us][to < from];
+    pos.remove(path.rookFrom);
+    pos.put(path.rookTo, makePiece(us, ROOK));
+  }
+
+  // the piece keys were updated by put and remove, swap the old state key for the new one
+  pos.key ^= pos.stateKey();
+  pos.castlingRights &= CASTLING_MASK[from] & CASTLING_MASK[to];
+  pos.enPassant = (typeOf(piece) == PAWN && (to ^ from) == 16) ? (from + to) / 2 : NO_SQUARE;
+
+  // increment the fullmove counter and switch active color
+  if (us == BLACK)
+    ++pos.fullmoveNumber;
+  pos.activeColor = Color(!us);
+  pos.key ^= pos.stateKey();
+  return undo;
+}
+
+// Intent: Take back the last move played on pos
+// Pre: undo was returned by makeMove(pos, m) and no other move is still on top of it
+// Post: pos is the position before the move
+inline void unmakeMove(Position &pos, Move m, const UndoInfo &undo) {
+  STAT_COUNT(STAT_UNMAKE_MOVES);
+  Color us = Color(!pos.activeColor);
+  uint8_t from = m.from(), to = m.to();
+
+  pos.activeColor = us;
+  if (us == BLACK)
+    --pos.fullmoveNumber;
+  pos.castlingRights = undo.castlingRights;
+  pos.enPassant = undo.enPassant;
+  pos.halfmoveClock = undo.halfmoveClock;
+
+  // put the rook back when castling
+  if (m.flag() == CASTLING) {
+    const CastlingPath &path = CASTLING_PATHS[us][to < from];
+    pos.remove(path.rookTo);
+    pos.put(path.rookFrom, makePiece(us, ROOK));
+  }
+
+  // move the piece back and undo the promotion
+  Piece piece = m.flag() == PROMOTION ? makePiece(us, PAWN) : pos.board[to];
+  pos.remove(to);
+  pos.put(from, piece);
+
+  if (m.flag() == EN_PASSANT)
+    pos.put(enPassantVictim(pos), undo.captured);
+  else if (undo.captured != NO_PIECE)
+    pos.put(to, undo.captured);
+  pos.key = undo.key;
+}
@@ -0,0 +1,375 @@
+/***************************************************************************
+ * File: nnue.h
+ * Author: 朱昱綸 (B11115022@mail.ntust.edu.tw)
+ *         張庭嘉 (B11115027@mail.ntust.edu.tw)
+ *         顏毓德 (B11115038@mail.ntust.edu.tw)
+ *         黃雋祐 (B11115048@mail.ntust.edu.tw)
+ * Create Date: Oct 16, 2026
+ * Update Date: Oct 16, 2026
+ * Description: Small NNUE-style evaluator: 768 piece-square inputs, an int16
+ *              accumulator per perspective updated move by move, a clipped
+ *              ReLU and one output. The kernels use AVX2 or SSE2 when the
+ *              native build enables them, SIMD128 when em++ gets -msimd128,
+ *              and plain C++ otherwise. (C++20)
+***************************************************************************/
+// Include guard
+#pragma once
+
+// Necessary headers
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <cstring>
+#include <istream>
+#include <iterator>
+#include <memory>
+#include <ostream>
+#include <type_traits>
+#include <utility>
+#include "eval.h"
+#include "movegen.h"
+
+#if defined(__AVX2__)
+  #include <immintrin.h>
+  #define USE_AVX2
+#endif
+#if defined(__SSE2__)
+  #include <emmintrin.h>
+  #define USE_SSE2
+#endif
+#if defined(__wasm_simd128__)
+  #include <wasm_simd128.h>
+  #define USE_SIMD128
+#endif
+
+// The network files store little-endian values and are read without conversion
+static_assert(std::endian::native == std::endian::little);
+
+// Inputs: (own or other side, piece type, square seen from the perspective) == 2 * 6 * 64
+constexpr unsigned NNUE_INPUTS = 768;
+constexpr unsigned NNUE_HIDDEN = 64;   // neurons per perspective, a multiple of 16
+constexpr int NNUE_CLIP = 255;         // the clipped ReLU keeps the accumulator within [0, NNUE_CLIP]
+constexpr uint32_t NNUE_VERSION = 1;
+constexpr char NNUE_MAGIC[4] = {'C', 'N', 'U', 'E'};
+
+enum NnueBackend : uint8_t { NNUE_SCALAR, NNUE_SSE2, NNUE_AVX2, NNUE_SIMD128 };
+
+constexpr const char *NNUE_BACKEND_NAMES[] = {"scalar", "sse2", "avx2", "simd128"};
+
+// Backends compiled into this build, the last one is used by default
+constexpr NnueBackend NNUE_BACKENDS[] = {
+  NNUE_SCALAR,
+#ifdef USE_SSE2
+  NNUE_SSE2,
+#endif
+#ifdef USE_AVX2
+  NNUE_AVX2,
+#endif
+#ifdef USE_SIMD128
+  NNUE_SIMD128,
+#endif
+};
+
+enum NnueStatus : uint8_t { NNUE_OK, NNUE_CANNOT_OPEN, NNUE_BAD_MAGIC, NNUE_BAD_VERSION, NNUE_BAD_SHAPE, NNUE_TRUNCATED };
+
+constexpr const char *NNUE_STATUS_TEXT[] = {
+  "ok", "cannot open file", "not a network file", "unsupported version", "wrong layer sizes", "file too short",
+};
+
+// Hidden layer before the activation, indexed by the perspective's Color
+struct Accumulator {
+  alignas(64) int16_t values[2][NNUE_HIDDEN];
+};
+
+// Intent: Get the input of a piece on a square as seen by one side, black sees the board mirrored
+// Pre: p != NO_PIECE, sq <= 63
+// Post: result < NNUE_INPUTS
+constexpr unsigned featureIndex(Color perspective, Piece p, uint8_t sq) {
+  unsigned other = colorOf(p) != perspective;
+  return (other * 6 + typeOf(p) - 1) * 64 + (perspective == WHITE ? sq : sq ^ 56);
+}
+
+// Intent: Compute child = parent + the added columns - the removed columns, one neuron per lane
+// Pre: Every pointer is 64-byte aligned and points to NNUE_HIDDEN values, child may be parent
+// Post: The sums wrap around like int16_t arithmetic in every backend
+template <NnueBackend B>
+inline void updateColumns(const int16_t *parent, int16_t *child, const int16_t *const *added, unsigned addCount,
+                          const int16_t *const *removed, unsigned removeCount) {
+  if constexpr (B == NNUE_AVX2) {
+#ifdef USE_AVX2
+    for (unsigned i = 0; i < NNUE_HIDDEN; i += 16) {
+      __m256i v = _mm256_load_si256(reinterpret_cast<const __m256i *>(parent + i));
+      for (unsigned a = 0; a < addCount; ++a)
+        v = _mm256_add_epi16(v, _mm256_load_si256(reinterpret_cast<const __m256i *>(added[a] + i)));
+      for (unsigned r = 0; r < removeCount; ++r)
+        v = _mm256_sub_epi16(v, _mm256_load_si256(reinterpret_cast<const __m256i *>(removed[r] + i)));
+      _mm256_store_si256(reinterpret_cast<__m256i *>(child + i), v);
+    }
+#endif
+  } else if constexpr (B == NNUE_SSE2) {
+#ifdef USE_SSE2
+    for (unsigned i = 0; i < NNUE_HIDDEN; i += 8) {
+      __m128i v = _mm_load_si128(reinterpret_cast<const __m128i *>(parent + i));
+      for (unsigned a = 0; a < addCount; ++a)
+        v = _mm_add_epi16(v, _mm_load_si128(reinterpret_cast<const __m128i *>(added[a] + i)));
+      for (unsigned r = 0; r < removeCount; ++r)
+        v = _mm_sub_epi16(v, _mm_load_si128(reinterpret_cast<const __m128i *>(removed[r] + i)));
+      _mm_store_si128(reinterpret_cast<__m128i *>(child + i), v);
+    }
+#endif
+  } else if constexpr (B == NNUE_SIMD128) {
+#ifdef USE_SIMD128
+    for (unsigned i = 0; i < NNUE_HIDDEN; i += 8) {
+      v128_t v = wasm_v128_load(parent + i);
+      for (unsigned a = 0; a < addCount; ++a)
+        v = wasm_i16x8_add(v, wasm_v128_load(added[a] + i));
+      for (unsigned r = 0; r < removeCount; ++r)
+        v = wasm_i16x8_sub(v, wasm_v128_load(removed[r] + i));
+      wasm_v128_store(child + i, v);
+    }
+#endif
+  } else {
+    for (unsigned i = 0; i < NNUE_HIDDEN; ++i) {
+      int16_t v = parent[i];
+      for (unsigned a = 0; a < addCount; ++a)
+        v = int16_t(v + added[a][i]);
+      for (unsigned r = 0; r < removeCount; ++r)
+        v = int16_t(v - removed[r][i]);
+      child[i] = v;
+    }
+  }
+}
+
+// Intent: Compute the sum of clamp(values[i], 0, NNUE_CLIP) * weights[i] over the hidden layer
+// Pre: Both pointers are 64-byte aligned and point to NNUE_HIDDEN values
+// Post: Every backend returns the same sum, it cannot overflow int32_t
+template <NnueBackend B>
+inline int32_t clippedDot(const int16_t *values, const int16_t *weights) {
+  if constexpr (B == NNUE_AVX2) {
+#ifdef USE_AVX2
+    __m256i sum = _mm256_setzero_si256(), zero = _mm256_setzero_si256(), clip = _mm256_set1_epi16(NNUE_CLIP);
+    for (unsigned i = 0; i < NNUE_HIDDEN; i += 16) {
+      __m256i v = _mm256_load_si256(reinterpret_cast<const __m256i *>(values + i));
+      v = _mm256_min_epi16(_mm256_max_epi16(v, zero), clip);
+      sum = _mm256_add_epi32(sum, _mm256_madd_epi16(v, _mm256_load_si256(reinterpret_cast<const __m256i *>(weights + i))));
+    }
+    __m128i half = _mm_add_epi32(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1));
+    half = _mm_add_epi32(half, _mm_shuffle_epi32(half, 0x4E));
+    half = _mm_add_epi32(half, _mm_shuffle_epi32(half, 0xB1));
+    return _mm_cvtsi128_si32(half);
+#endif
+  } else if constexpr (B == NNUE_SSE2) {
+#ifdef USE_SSE2
+    __m128i sum = _mm_setzero_si128(), zero = _mm_setzero_si128(), clip = _mm_set1_epi16(NNUE_CLIP);
+    for (unsigned i = 0; i < NNUE_HIDDEN; i += 8) {
+      __m128i v = _mm_load_si128(reinterpret_cast<const __m128i *>(values + i));
+      v = _mm_min_epi16(_mm_max_epi16(v, zero), clip);
+      sum = _mm_add_epi32(sum, _mm_madd_epi16(v, _mm_load_si128(reinterpret_cast<const __m128i *>(weights + i))));
+    }
+    sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0x4E));
+    sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, 0xB1));
+    return _mm_cvtsi128_si32(sum);
+#endif
+  } else if constexpr (B == NNUE_SIMD128) {
+#ifdef USE_SIMD128
+    v128_t sum = wasm_i32x4_splat(0), zero = wasm_i16x8_splat(0), clip = wasm_i16x8_splat(NNUE_CLIP);
+    for (unsigned i = 0; i < NNUE_HIDDEN; i += 8) {
+      v128_t v = wasm_i16x8_min(wasm_i16x8_max(wasm_v128_load(values + i), zero), clip);
+      sum = wasm_i32x4_add(sum, wasm_i32x4_dot_i16x8(v, wasm_v128_load(weights + i)));
+    }
+    return wasm_i32x4_extract_lane(sum, 0) + wasm_i32x4_extract_lane(sum, 1)
+         + wasm_i32x4_extract_lane(sum, 2) + wasm_i32x4_extract_lane(sum, 3);
+#endif
+  }
+  int32_t sum = 0;
+  for (unsigned i = 0; i < NNUE_HIDDEN; ++i)
+    sum += std::clamp<int32_t>(values[i], 0, NNUE_CLIP) * weights[i];
+  return sum;
+}
+
+// Weights of the whole network, about 100 KB, allocate it on the heap
+class Network {
+public:
+  // Intent: Build the network that reproduces the material and middle game piece-square score of
+  //         eval.h, used when no trained network is loaded: neuron t - 1 of a perspective sums its
+  //         own pieces of type t, neuron t + 5 those of the other side, each divided by
+  //         PST_SCALE[t] to stay within the clipping range, the king neurons start at 64
+  // Pre: None
+  // Post: The score differs from evaluate by the rounding of each piece and the endgame king table
+  static std::unique_ptr<Network> fromPieceSquareTables() {
+    constexpr int PST_SCALE[7] = {0, 5, 8, 8, 12, 16, 1};
+    constexpr int KING_BIAS = 64;
+    auto net = std::make_unique<Network>();
+    for (int t = PAWN; t <= KING; ++t) {
+      for (unsigned sq = 0; sq < 64; ++sq) {
+        // seen from the perspective, the other side's pieces use the mirrored table
+        int own = PIECE_VALUES[t] + PST[t][sq], other = PIECE_VALUES[t] + PST[t][sq ^ 56];
+        auto round = [&](int value) { return int16_t((value + (value >= 0 ? 1 : -1) * PST_SCALE[t] / 2) / PST_SCALE[t]); };
+        net->featureWeights[(t - 1) * 64 + sq][t - 1] = round(own);
+        net->featureWeights[(6 + t - 1) * 64 + sq][t + 5] = round(other);
+      }
+      net->outputWeights[0][t - 1] = int16_t(PST_SCALE[t]);
+      net->outputWeights[0][t + 5] = int16_t(-PST_SCALE[t]);
+    }
+    net->featureBias[KING - 1] = net->featureBias[KING + 5] = KING_BIAS;
+    net->outputDivisor = 1;
+    return net;
+  }
+
+  // Intent: Read a network file: "CNUE", then little-endian uint32 version, inputs and hidden size,
+  //         int16 feature weights [inputs][hidden], int16 feature biases [hidden],
+  //         int16 output weights [2][hidden] (side to move first), int32 output bias and divisor
+  // Pre: None
+  // Post: net is only replaced if the whole file was valid
+  static NnueStatus load(std::istream &in, std::unique_ptr<Network> &net) {
+    char magic[4];
+    uint32_t header[3];
+    if (!in.read(magic, 4) || !std::equal(magic, magic + 4, NNUE_MAGIC))
+      return NNUE_BAD_MAGIC;
+    if (!in.read(reinterpret_cast<char *>(header), sizeof(header)))
+      return NNUE_TRUNCATED;
+    if (header[0] != NNUE_VERSION)
+      return NNUE_BAD_VERSION;
+    if (header[1] != NNUE_INPUTS || header[2] != NNUE_HIDDEN)
+      return NNUE_BAD_SHAPE;
+
+    auto next = std::make_unique<Network>();
+    for (auto [data, size] : sections(*next))
+      if (!in.read(static_cast<char *>(data), std::streamsize(size)))
+        return NNUE_TRUNCATED;
+    if (next->outputDivisor <= 0)
+      return NNUE_BAD_SHAPE;
+    net = std::move(next);
+    return NNUE_OK;
+  }
+
+  // Intent: Write the network in the format read by load
+  // Pre: None
+  // Post: None
+  void save(std::ostream &out) const {
+    uint32_t header[3] = {NNUE_VERSION, NNUE_INPUTS, NNUE_HIDDEN};
+    out.write(NNUE_MAGIC, 4);
+    out.write(reinterpret_cast<const char *>(header), sizeof(header));
+    for (auto [data, size] : sections(*this))
+      out.write(static_cast<const char *>(data), std::streamsize(size));
+  }
+
+  // Intent: Choose the kernels, for comparing backends
+  // Pre: b is one of NNUE_BACKENDS
+  // Post: None
+  void setBackend(NnueBackend b) { backend = b; }
+  NnueBackend getBackend() const { return backend; }
+
+  // Intent: Compute both perspectives of the accumulator from scratch
+  // Pre: None
+  // Post: None
+  void refresh(const Position &pos, Accumulator &acc) const {
+    for (Color perspective : {WHITE, BLACK}) {
+      const int16_t *columns[64];
+      unsigned count = 0;
+      for (Bitboard b = pos.occupied(); b; ) {
+        uint8_t sq = popLsb(b);
+        columns[count++] = featureWeights[featureIndex(perspective, pos.board[sq], sq)];
+      }
+      dispatch([&]<NnueBackend B>() { updateColumns<B>(featureBias, acc.values[perspective], columns, count, nullptr, 0); });
+    }
+  }
+
+  // Intent: Compute the accumulator after a move from the one before it, only the columns of the
+  //         2 to 4 pieces the move touches are added or removed
+  // Pre: parent matches pos, m is a legal move of pos that has not been played yet
+  // Post: child matches the position after the move, it may be parent
+  void update(const Accumulator &parent, Accumulator &child, const Position &pos, Move m) const {
+    Color us = pos.activeColor;
+    uint8_t from = m.from(), to = m.to();
+    Piece piece = pos.board[from];
+    std::pair<Piece, uint8_t> added[2], removed[2];
+    unsigned addCount = 0, removeCount = 0;
+
+    removed[removeCount++] = {piece, from};
+    added[addCount++] = {m.flag() == PROMOTION ? makePiece(us, m.promotionType()) : piece, to};
+    if (m.flag() == EN_PASSANT)
+      removed[removeCount++] = {pos.board[enPassantVictim(pos)], enPassantVictim(pos)};
+    else if (pos.board[to] != NO_PIECE)
+      removed[removeCount++] = {pos.board[to], to};
+    if (m.flag() == CASTLING) {
+      const CastlingPath &path = CASTLING_PATHS[us][to < from];
+      removed[removeCount++] = {makePiece(us, ROOK), path.rookFrom};
+      added[addCount++] = {makePiece(us, ROOK), path.rookTo};
+    }
+
+    for (Color perspective : {WHITE, BLACK}) {
+      const int16_t *addColumns[2], *removeColumns[2];
+      for (unsigned i = 0; i < addCount; ++i)
+        addColumns[i] = featureWeights[featureIndex(perspective, added[i].first, added[i].second)];
+      for (unsigned i = 0; i < removeCount; ++i)
+        removeColumns[i] = featureWeights[featureIndex(perspective, removed[i].first, removed[i].second)];
+      dispatch([&]<NnueBackend B>() {
+        updateColumns<B>(parent.values[perspective], child.values[perspective], addColumns, addCount, removeColumns, removeCount);
+      });
+    }
+  }
+
+  // Intent: Evaluate the position of an accumulator
+  // Pre: acc matches a position where sideToMove is to move
+  // Post: The score is in centipawns from the point of view of the side to move
+  int evaluate(const Accumulator &acc, Color sideToMove) const {
+    int32_t sum = outputBias;
+    dispatch([&]<NnueBackend B>() {
+      sum += clippedDot<B>(acc.values[sideToMove], outputWeights[0]) + clippedDot<B>(acc.values[!sideToMove], outputWeights[1]);
+    });
+    return sum / outputDivisor;
+  }
+
+  // Intent: Evaluate a position without an accumulator kept from its parent
+  // Pre: None
+  // Post: Same score as refresh followed by evaluate
+  int evaluate(const Position &pos) const {
+    Accumulator acc;
+    refresh(pos, acc);
+    return evaluate(acc, pos.activeColor);
+  }
+
+private:
+  // Intent: Run f.template operator()<B>() with the selected backend
+  // Pre: None
+  // Post: None
+  template <typename F>
+  void dispatch(F &&f) const {
+    switch (backend) {
+#ifdef USE_AVX2
+      case NNUE_AVX2: return f.template operator()<NNUE_AVX2>();
+#endif
+#ifdef USE_SSE2
+      case NNUE_SSE2: return f.template operator()<NNUE_SSE2>();
+#endif
+#ifdef USE_SIMD128
+      case NNUE_SIMD128: return f.template operator()<NNUE_SIMD128>();
+#endif
+      default: return f.template operator()<NNUE_SCALAR>();
+    }
+  }
+
+  // Intent: List the weight arrays of a network in file order
+  // Pre: None
+  // Post: The pointers are const if net is
+  template <typename Self>
+  using Sections = std::array<std::pair<std::conditional_t<std::is_const_v<Self>, const void *, void *>, size_t>, 5>;
+
+  template <typename Self>
+  static Sections<Self> sections(Self &net) {
+    return {{
+      {net.featureWeights, sizeof(net.featureWeights)}, {net.featureBias, sizeof(net.featureBias)},
+      {net.outputWeights, sizeof(net.outputWeights)}, {&net.outputBias, sizeof(net.outputBias)},
+      {&net.outputDivisor, sizeof(net.outputDivisor)},
+    }};
+  }
+
+  alignas(64) int16_t featureWeights[NNUE_INPUTS][NNUE_HIDDEN] = {};
+  alignas(64) int16_t featureBias[NNUE_HIDDEN] = {};
+  alignas(64) int16_t outputWeights[2][NNUE_HIDDEN] = {};  // side to move, other side
+  int32_t outputBias = 0;
+  int32_t outputDivisor = 1;
+  NnueBackend backend = NNUE_BACKENDS[std::size(NNUE_BACKENDS) - 1];
+};
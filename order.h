@@ -0,0 +1,186 @@
+/***************************************************************************
+ * File: order.h
+ * Author: 朱昱綸 (B11115022@mail.ntust.edu.tw)
+ *         張庭嘉 (B11115027@mail.ntust.edu.tw)
+ *         顏毓德 (B11115038@mail.ntust.edu.tw)
+ *         黃雋祐 (B11115048@mail.ntust.edu.tw)
+ * Create Date: Oct 16, 2026
+ * Update Date: Oct 16, 2026
+ * Description: Static exchange evaluation and the move ordering of the
+ *              search: hash move, captures by SEE and MVV-LVA, killer
+ *              moves and the history of quiet moves. (C++20)
+***************************************************************************/
+// Include guard
+#pragma once
+
+// Necessary headers
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include "movegen.h"
+
+// Deepest ply the search reaches, killers are kept per ply
+constexpr unsigned MAX_PLY = 128;
+
+// Piece values of the exchanges, a king is worth more than everything it could take
+constexpr int SEE_VALUES[7] = {0, 100, 320, 330, 500, 900, 20000};
+
+// How much ordering the search does, the weaker modes are only there to measure the others
+enum MoveOrdering : uint8_t { ORDER_NONE, ORDER_MVV_LVA, ORDER_FULL };
+
+constexpr const char *MOVE_ORDERING_TEXT[] = {"none", "MVV-LVA", "full"};
+
+// Intent: Check if a move takes a piece or promotes, the moves searched by quiescence
+// Pre: m is a legal move of pos
+// Post: None
+inline bool isTactical(const Position &pos, Move m) {
+  return pos.board[m.to()] != NO_PIECE || m.flag() == EN_PASSANT || m.flag() == PROMOTION;
+}
+
+// Intent: Get the material the side to move wins by playing m and then letting both sides
+//         recapture on the target square with their least valuable piece for as long as it pays.
+//         Sliders behind a capturing piece join in, pins are not looked at.
+// Pre: m is a legal move of pos
+// Post: result == 0 for castling and for quiet moves to squares the enemy does not attack
+inline int see(const Position &pos, Move m) {
+  if (m.flag() == CASTLING)
+    return 0;
+  uint8_t from = m.from(), to = m.to();
+  Bitboard occupied = pos.occupied() ^ bit(from);
+  // a square is reached from at most 27 squares on its lines and 8 knight squares, every capture
+  // takes one of those pieces away, so no exchange runs past 35 captures
+  int gain[64];
+  gain[0] = SEE_VALUES[typeOf(pos.board[to])];
+  PieceType onSquare = typeOf(pos.board[from]);
+  if (m.flag() == EN_PASSANT) {
+    gain[0] = SEE_VALUES[PAWN];
+    occupied ^= bit(enPassantVictim(pos));
+  } else if (m.flag() == PROMOTION) {
+    gain[0] += SEE_VALUES[m.promotionType()] - SEE_VALUES[PAWN];
+    onSquare = m.promotionType();
+  }
+
+  // gain[d] is what the side making capture d wins if the exchange stops after it. The whole
+  // sequence is played out, the usual cut when neither side can gain keeps the sign of the
+  // result but not its value, and getStaticExchange reports the value.
+  Color side = Color(!pos.activeColor);
+  unsigned d = 0;
+  for (Bitboard attackers = pos.attackersTo(to, occupied) & occupied; ; side = Color(!side)) {
+    Bitboard ours = attackers & pos.byColor[side];
+    if (!ours)
+      break;
+    PieceType next = PAWN;
+    while (!(ours & pos.byType[next]))
+      next = PieceType(next + 1);
+    // a king may not take back while the other side still attacks the square
+    if (next == KING && (attackers & pos.byColor[!side]))
+      break;
+
+    ++d;
+    gain[d] = SEE_VALUES[onSquare] - gain[d - 1];
+    occupied ^= bit(lsb(ours & pos.byType[next]));
+    attackers = pos.attackersTo(to, occupied) & occupied;
+    onSquare = next;
+  }
+
+  // each side may stop capturing when going on loses
+  while (d) {
+    gain[d - 1] = -std::max(-gain[d - 1], gain[d]);
+    --d;
+  }
+  return gain[0];
+}
+
+// Killer moves and the history of quiet moves, learned by one Searcher during its search
+class MoveHistory {
+public:
+  static constexpr int HISTORY_MAX = 16384;
+
+  // Intent: Order moves in place: the hash move, captures that do not lose material by
+  //         MVV-LVA, the two killers of ply, losing captures, the other quiet moves by history.
+  //         Losing captures still come before the quiet moves, they cut off more often.
+  // Pre: ply < MAX_PLY
+  // Post: ORDER_MVV_LVA puts the hash move and then every capture by MVV-LVA first,
+  //       ORDER_NONE keeps the generation order
+  void order(const Position &pos, MoveList &moves, Move ttMove, unsigned ply, MoveOrdering mode) const {
+    if (mode == ORDER_NONE)
+      return;
+
+    int scores[MAX_MOVES];
+    for (size_t i = 0; i < moves.size(); ++i) {
+      Move m = moves[i];
+      if (m == ttMove) {
+        scores[i] = 1 << 30;
+      } else if (isTactical(pos, m)) {
+        PieceType victim = m.flag() == EN_PASSANT ? PAWN : typeOf(pos.board[m.to()]);
+        int mvvLva = 8 * victim - typeOf(pos.board[m.from()]);
+        scores[i] = (mode == ORDER_MVV_LVA || see(pos, m) >= 0 ? 1 << 28 : 1 << 26) + mvvLva;
+      } else if (mode == ORDER_MVV_LVA) {
+        scores[i] = 0;
+      } else {
+        scores[i] = m == killers[ply][0] ? (1 << 27) : m == killers[ply][1] ? (1 << 27) - 1
+                  : history[pos.activeColor][m.from()][m.to()];
+      }
+    }
+
+    // insertion sort, stable and fast on lists of a few dozen moves
+    for (size_t i = 1; i < moves.size(); ++i) {
+      Move m = moves.moves[i];
+      int score = scores[i];
+      size_t j = i;
+      for (; j && scores[j - 1] < score; --j) {
+        moves.moves[j] = moves.moves[j - 1];
+        scores[j] = scores[j - 1];
+      }
+      moves.moves[j] = m;
+      scores[j] = score;
+    }
+  }
+
+  // Intent: Learn from a quiet move that failed high: it becomes the first killer of ply,
+  //         its history grows and the history of the quiet moves tried before it shrinks
+  // Pre: best is a quiet move of pos, [tried, triedEnd) are the moves searched before it at
+  //      this node, ply < MAX_PLY
+  // Post: Every history stays within [-HISTORY_MAX, HISTORY_MAX]
+  void cutoff(const Position &pos, Move best, unsigned ply, int depth, const Move *tried, const Move *triedEnd) {
+    if (killers[ply][0] != best) {
+      killers[ply][1] = killers[ply][0];
+      killers[ply][0] = best;
+    }
+    int bonus = std::min(depth * depth, 400);
+    update(history[pos.activeColor][best.from()][best.to()], bonus);
+    for (; tried != triedEnd; ++tried)
+      if (!isTactical(pos, *tried))
+        update(history[pos.activeColor][tried->from()][tried->to()], -bonus);
+  }
+
+private:
+  // Intent: Move an entry towards the bonus, less the closer it already is to the limit
+  // Pre: |bonus| <= HISTORY_MAX
+  // Post: None
+  static void update(int16_t &entry, int bonus) {
+    entry = int16_t(entry + bonus - entry * std::abs(bonus) / HISTORY_MAX);
+  }
+
+  Move killers[MAX_PLY][2] = {};
+  int16_t history[2][64][64] = {};
+};
+
+// Intent: Find the pieces of color c, kings aside, that the other side wins material by taking
+//         if it were its turn, for a front end to mark them as hanging
+// Pre: None
+// Post: None
+inline Bitboard hangingPieces(const Position &pos, Color c) {
+  Position them = pos;
+  if (them.activeColor == c) {
+    them.activeColor = Color(!c);
+    them.enPassant = NO_SQUARE;
+  }
+  MoveList moves;
+  generateLegalMoves(them, moves);
+  Bitboard result = 0;
+  for (Move m : moves)
+    if (them.board[m.to()] != NO_PIECE && typeOf(them.board[m.to()]) != KING && see(them, m) > 0)
+      result |= bit(m.to());
+  return result;
+}
@@ -0,0 +1,86 @@
+/***************************************************************************
+ * File: perft.h
+ * Author: 朱昱綸 (B11115022@mail.ntust.edu.tw)
+ *         張庭嘉 (B11115027@mail.ntust.edu.tw)
+ *         顏毓德 (B11115038@mail.ntust.edu.tw)
+ *         黃雋祐 (B11115048@mail.ntust.edu.tw)
+ * Create Date: Oct 16, 2026
+ * Update Date: Oct 16, 2026
+ * Description: Move path enumeration (perft) used to verify and benchmark
+ *              the move generator. (C++20)
+***************************************************************************/
+// Include guard
+#pragma once
+
+// Necessary headers
+#include <cstdint>
+#include <utility>
+#include <vector>
+#include "movegen.h"
+#include "tt.h"
+
+// Intent: Count the leaf nodes of the legal move tree of pos to the given depth
+// Pre: None
+// Post: result == 1 if depth == 0, pos is unchanged
+inline uint64_t perft(Position &pos, unsigned depth) {
+  if (depth == 0)
+    return 1;
+
+  MoveList moves;
+  generateLegalMoves(pos, moves);
+
+  // bulk counting: the leaves below the last ply are the generated moves themselves
+  if (depth == 1)
+    return moves.size();
+
+  uint64_t nodes = 0;
+  for (const Move &m : moves) {
+    UndoInfo undo = makeMove(pos, m);
+    nodes += perft(pos, depth - 1);
+    unmakeMove(pos, m, undo);
+  }
+  return nodes;
+}
+
+// Intent: Count the leaf nodes like perft, looking up transposed subtrees in tt
+// Pre: None
+// Post: result == perft(pos, depth), pos is unchanged, the probes and stores are added to stats
+inline uint64_t hashedPerft(Position &pos, unsigned depth, TranspositionTable &tt, TTStats &stats) {
+  if (depth <= 1)
+    return perft(pos, depth);
+
+  uint64_t nodes = 0;
+  if (tt.probeNodes(pos.key, depth, nodes)) {
+    ++stats.hits;
+    return nodes;
+  }
+  ++stats.misses;
+
+  MoveList moves;
+  generateLegalMoves(pos, moves);
+  for (const Move &m : moves) {
+    UndoInfo undo = makeMove(pos, m);
+    nodes += hashedPerft(pos, depth - 1, tt, stats);
+    unmakeMove(pos, m, undo);
+  }
+
+  ++stats.stores;
+  stats.collisions += tt.storeNodes(pos.key, depth, nodes);
+  return nodes;
+}
+
+// Intent: Count the leaf nodes below each legal move of pos (perft "divide")
+// Pre: depth >= 1
+// Post: The counts add up to perft(pos, depth), pos is unchanged
+inline std::vector<std::pair<Move, uint64_t>> divide(Position &pos, unsigned depth) {
+  MoveList moves;
+  generateLegalMoves(pos, moves);
+
+  std::vector<std::pair<Move, uint64_t>> result;
+  for (const Move &m : moves) {
+    UndoInfo undo = makeMove(pos, m);
+    result.push_back({m, perft(pos, depth - 1)});
+    unmakeMove(pos, m, undo);
+  }
+  return result;
+}
@@ -0,0 +1,262 @@
+/***************************************************************************
+ * File: pgn.h
+ * Author: 朱昱綸 (B11115022@mail.ntust.edu.tw)
+ *         張庭嘉 (B11115027@mail.ntust.edu.tw)
+ *         顏毓德 (B11115038@mail.ntust.edu.tw)
+ *         黃雋祐 (B11115048@mail.ntust.edu.tw)
+ * Create Date: Oct 16, 2026
+ * Update Date: Oct 16, 2026
+ * Description: Streaming PGN reader that decodes SAN, checks every move
+ *              with the legal move generator and replays each game to its
+ *              final position, one game per task. (C++20)
+***************************************************************************/
+// Include guard
+#pragma once
+
+// Necessary headers
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <functional>
+#include <istream>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "fen.h"
+#include "movegen.h"
+#include "pool.h"
+
+// Why a game could not be replayed
+enum PgnError : uint8_t { PGN_OK, PGN_BAD_FEN_TAG, PGN_BAD_TAG, PGN_BAD_TOKEN, PGN_ILLEGAL_MOVE, PGN_AMBIGUOUS_MOVE };
+
+constexpr const char *PGN_ERROR_TEXT[] = {
+  "ok", "invalid FEN tag", "malformed tag", "unreadable token", "illegal move", "ambiguous move",
+};
+
+constexpr char INITIAL_FEN[] = "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1";
+
+// Outcome of one game, kept free of heap memory so a chunk of reports can be reused
+struct GameReport {
+  uint64_t index = 0;      // 1 for the first game of the stream
+  uint32_t plies = 0;      // plies replayed, the failing ply is plies + 1
+  PgnError error = PGN_OK;
+  char token[16] = {};     // the offending token, cut to 15 characters
+  Position final{};        // the position after the last replayed ply
+};
+
+// Called with the position before each replayed ply, the move and the number of plies before it
+using PlyCallback = std::function<void(const Position &, Move, uint32_t)>;
+
+struct PgnStats {
+  uint64_t games = 0;
+  uint64_t invalid = 0;
+  uint64_t plies = 0;
+  double seconds = 0;
+};
+
+// Intent: Decode a SAN move such as "e4", "Nbd7", "exd8=Q+" or "O-O-O" among the legal moves of pos
+// Pre: moves holds the legal moves of pos
+// Post: Return PGN_OK and set m if exactly one legal move matches, check and annotation marks are ignored
+inline PgnError decodeSAN(const Position &pos, const MoveList &moves, std::string_view san, Move &m) {
+  while (san.size() && std::strchr("+#!?", san.back()))
+    san.remove_suffix(1);
+
+  auto unique = [&](auto matches) {
+    const Move *found = nullptr;
+    for (const Move &legal : moves) {
+      if (matches(legal)) {
+        if (found)
+          return PGN_AMBIGUOUS_MOVE;
+        found = &legal;
+      }
+    }
+    if (!found)
+      return PGN_ILLEGAL_MOVE;
+    m = *found;
+    return PGN_OK;
+  };
+
+  // castling, also written with zeros
+  if (san == "O-O" || san == "0-0" || san == "O-O-O" || san == "0-0-0") {
+    bool queenside = san.size() == 5;
+    return unique([&](Move legal) { return legal.flag() == CASTLING && (legal.to() < legal.from()) == queenside; });
+  }
+
+  PieceType type = PAWN;
+  if (san.size() && std::strchr("KQRBN", san[0]) && san[0]) {
+    type = typeOf(charToPiece(san[0]));
+    san.remove_prefix(1);
+  }
+
+  // promotion, "e8=Q" or "e8Q"
+  PieceType promotion = NO_TYPE;
+  if (type == PAWN && san.size() >= 2 && std::strchr("QRBN", san.back()) && san.back()) {
+    promotion = typeOf(charToPiece(san.back()));
+    san.remove_suffix(san[san.size() - 2] == '=' ? 2 : 1);
+  }
+
+  // target square, then optional disambiguation file and rank before an optional 'x'
+  if (san.size() < 2)
+    return PGN_BAD_TOKEN;
+  char file = san[san.size() - 2], rank = san.back();
+  if (file < 'a' || file > 'h' || rank < '1' || rank > '8')
+    return PGN_BAD_TOKEN;
+  uint8_t to = xy2sq(file - 'a', '8' - rank);
+  san.remove_suffix(2);
+  if (san.size() && san.back() == 'x')
+    san.remove_suffix(1);
+
+  int fromFile = -1, fromRank = -1;
+  for (char c : san) {
+    if (c >= 'a' && c <= 'h')
+      fromFile = c - 'a';
+    else if (c >= '1' && c <= '8')
+      fromRank = '8' - c;
+    else
+      return PGN_BAD_TOKEN;
+  }
+
+  return unique([&](Move legal) {
+    return legal.to() == to && typeOf(pos.board[legal.from()]) == type
+        && (legal.flag() == PROMOTION ? legal.promotionType() == promotion : promotion == NO_TYPE)
+        && (fromFile < 0 || legal.from() % 8 == fromFile) && (fromRank < 0 || legal.from() / 8 == fromRank);
+  });
+}
+
+// Intent: Replay one game, tags first and then the movetext up to the result or the end of the text
+// Pre: None
+// Post: report.plies and report.final describe how far the game could be replayed,
+//       onPly is called for every replayed ply if it is set
+inline void replayGame(std::string_view game, GameReport &report, const PlyCallback &onPly = {}) {
+  size_t i = 0;
+  auto skipSpace = [&] { while (i < game.size() && std::strchr(" \t\r\n", game[i]) && game[i]) ++i; };
+  auto fail = [&](PgnError error, std::string_view token) {
+    report.error = error;
+    size_t n = std::min(token.size(), sizeof(report.token) - 1);
+    std::copy_n(token.data(), n, report.token);
+    report.token[n] = '\0';
+  };
+
+  report.plies = 0;
+  report.error = PGN_OK;
+  report.token[0] = '\0';
+  readFEN(INITIAL_FEN, report.final);
+
+  // tag pairs: [Name "Value"], only the FEN tag changes the replay
+  for (skipSpace(); i < game.size() && game[i] == '['; skipSpace()) {
+    size_t nameEnd = game.find_first_of(" \"]", i);
+    size_t open = game.find('"', i), close = open == std::string_view::npos ? open : game.find('"', open + 1);
+    size_t end = close == std::string_view::npos ? close : game.find(']', close);
+    if (end == std::string_view::npos)
+      return fail(PGN_BAD_TAG, game.substr(i, 15));
+    if (game.substr(i + 1, nameEnd - i - 1) == "FEN" && readFEN(game.substr(open + 1, close - open - 1), report.final) != PARSE_OK)
+      return fail(PGN_BAD_FEN_TAG, game.substr(open + 1, close - open - 1));
+    i = end + 1;
+  }
+
+  Position &pos = report.final;
+  while (true) {
+    skipSpace();
+    if (i >= game.size())
+      return;
+
+    // comments, variations, numeric annotation glyphs and escaped lines carry no moves
+    char c = game[i];
+    if (c == '{') {
+      i = std::min(game.find('}', i), game.size()) + 1;
+      continue;
+    }
+    if (c == ';' || c == '%') {
+      i = std::min(game.find('\n', i), game.size());
+      continue;
+    }
+    if (c == '(') {
+      for (size_t depth = 0; i < game.size(); ++i) {
+        if (game[i] == '{')
+          i = std::min(game.find('}', i), game.size() - 1);
+        else if (game[i] == '(')
+          ++depth;
+        else if (game[i] == ')' && --depth == 0)
+          break;
+      }
+      ++i;
+      continue;
+    }
+
+    size_t end = std::min(game.find_first_of(" \t\r\n{}();", i), game.size());
+    std::string_view token = game.substr(i, end - i);
+    i = std::max(end, i + 1);
+    if (c == '$' || c == ')' || c == '}')
+      continue;
+    if (token == "1-0" || token == "0-1" || token == "1/2-1/2" || token == "*")
+      return;
+
+    // move numbers such as "12." or "12..." may be glued to the move
+    size_t digits = token.find_first_not_of("0123456789");
+    if (digits != std::string_view::npos && digits && token[digits] == '.')
+      token.remove_prefix(std::min(token.find_first_not_of('.', digits), token.size()));
+    if (token.empty())
+      continue;
+
+    MoveList moves;
+    generateLegalMoves(pos, moves);
+    Move m;
+    if (PgnError error = decodeSAN(pos, moves, token, m))
+      return fail(error, token);
+    if (onPly)
+      onPly(pos, m, report.plies);
+    makeMove(pos, m);
+    ++report.plies;
+  }
+}
+
+// Intent: Split a PGN stream into games, replay them on the pool one game per task and pass
+//         the reports to onGame in stream order, chunkGames games at a time
+// Pre: pool.size() >= 1, chunkGames >= 1, onPly can run concurrently if pool.size() > 1
+// Post: The game buffers and reports are reused from chunk to chunk
+inline PgnStats validatePgn(std::istream &in, WorkerPool &pool, size_t chunkGames,
+                            const std::function<void(const GameReport &)> &onGame, const PlyCallback &onPly = {}) {
+  auto start = std::chrono::steady_clock::now();
+  PgnStats stats;
+  std::vector<std::string> games(chunkGames);
+  std::vector<GameReport> reports(chunkGames);
+  std::string line;
+  bool pendingLine = false;
+
+  while (in || pendingLine) {
+    // a tag line after movetext starts the next game
+    size_t count = 0;
+    while (count < chunkGames && (pendingLine || std::getline(in, line))) {
+      std::string &game = games[count];
+      game.clear();
+      bool movetext = false;
+      do {
+        pendingLine = false;
+        size_t first = line.find_first_not_of(" \t\r");
+        if (first != std::string::npos && line[first] == '[' && movetext) {
+          pendingLine = true;
+          break;
+        }
+        movetext = movetext || (first != std::string::npos && line[first] != '[');
+        game += line;
+        game += '\n';
+      } while (std::getline(in, line));
+      if (game.find_first_not_of(" \t\r\n") != std::string::npos)
+        ++count;
+    }
+    if (!count)
+      break;
+
+    pool.run(count, [&](size_t i, unsigned) { replayGame(games[i], reports[i], onPly); });
+
+    for (size_t i = 0; i < count; ++i) {
+      reports[i].index = ++stats.games;
+      stats.plies += reports[i].plies;
+      stats.invalid += reports[i].error != PGN_OK;
+      onGame(reports[i]);
+    }
+  }
+
+  stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  return stats;
+}
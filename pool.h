@@ -0,0 +1,125 @@
+/***************************************************************************
+ * File: pool.h
+ * Author: 朱昱綸 (B11115022@mail.ntust.edu.tw)
+ *         張庭嘉 (B11115027@mail.ntust.edu.tw)
+ *         顏毓德 (B11115038@mail.ntust.edu.tw)
+ *         黃雋祐 (B11115048@mail.ntust.edu.tw)
+ * Create Date: Oct 16, 2026
+ * Update Date: Oct 16, 2026
+ * Description: Fixed pool of threads that run the tasks of one chunk of
+ *              work at a time, used by the batch and PGN pipelines, and a
+ *              bounded lock-free queue from one thread to another. (C++20)
+***************************************************************************/
+// Include guard
+#pragma once
+
+// Necessary headers
+#include <array>
+#include <atomic>
+#include <barrier>
+#include <cstddef>
+#include <functional>
+#include <thread>
+#include <vector>
+
+// The calling thread takes part in every run, so a pool of 1 starts no thread at all.
+// Between runs the helpers wait on a barrier, the caller can refill its buffers then.
+class WorkerPool {
+public:
+  using Task = std::function<void(size_t index, unsigned worker)>;
+
+  // Intent: Start threads - 1 helper threads
+  // Pre: threads >= 1
+  // Post: None
+  explicit WorkerPool(unsigned threads) : sync(threads) {
+    for (unsigned worker = 1; worker < threads; ++worker) {
+      helpers.emplace_back([this, worker] {
+        while (sync.arrive_and_wait(), task) {
+          work(worker);
+          sync.arrive_and_wait();
+        }
+      });
+    }
+  }
+
+  // Intent: Stop and join the helpers
+  // Pre: No run is in progress
+  // Post: None
+  ~WorkerPool() {
+    task = nullptr;
+    sync.arrive_and_wait();
+    for (std::thread &t : helpers)
+      t.join();
+  }
+
+  WorkerPool(const WorkerPool &) = delete;
+  WorkerPool &operator=(const WorkerPool &) = delete;
+
+  // Intent: Get the number of workers, including the calling thread as worker 0
+  // Pre: None
+  // Post: None
+  unsigned size() const { return unsigned(helpers.size() + 1); }
+
+  // Intent: Call f(i, worker) for every i < count, spread over the workers
+  // Pre: f can run concurrently for different i, only from the thread that created the pool
+  // Post: Every call has returned
+  void run(size_t count, const Task &f) {
+    total = count;
+    next = 0;
+    task = &f;
+    sync.arrive_and_wait();
+    work(0);
+    sync.arrive_and_wait();
+  }
+
+private:
+  // Intent: Take indices until none is left
+  // Pre: task != nullptr
+  // Post: None
+  void work(unsigned worker) {
+    for (size_t i; (i = next.fetch_add(1, std::memory_order_relaxed)) < total; )
+      (*task)(i, worker);
+  }
+
+  std::barrier<> sync;
+  std::vector<std::thread> helpers;
+  std::atomic<size_t> next = 0;
+  size_t total = 0;
+  const Task *task = nullptr;
+};
+
+// Bounded ring passing values from one producer thread to one consumer thread without locks.
+// Each side owns one index and only reads the other, the indices never wrap in practice.
+template<class T, size_t N>
+class SpscQueue {
+public:
+  // Intent: Move value into the queue
+  // Pre: Only called by the producer
+  // Post: Return false and leave value alone if the queue is full
+  bool push(T &value) {
+    size_t t = tail.load(std::memory_order_relaxed);
+    if (t - head.load(std::memory_order_acquire) == N)
+      return false;
+    slots[t % N] = std::move(value);
+    tail.store(t + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Intent: Move the oldest value out of the queue
+  // Pre: Only called by the consumer
+  // Post: Return false if the queue is empty
+  bool pop(T &value) {
+    size_t h = head.load(std::memory_order_relaxed);
+    if (h == tail.load(std::memory_order_acquire))
+      return false;
+    value = std::move(slots[h % N]);
+    head.store(h + 1, std::memory_order_release);
+    return true;
+  }
+
+private:
+  std::array<T, N> slots{};
+  // on separate cache lines, so the producer and the consumer do not invalidate each other's index
+  alignas(64) std::atomic<size_t> head = 0;
+  alignas(64) std::atomic<size_t> tail = 0;
+};
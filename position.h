@@ -0,0 +1,164 @@
+/***************************************************************************
+ * File: position.h
+ * Author: 朱昱綸 (B11115022@mail.ntust.edu.tw)
+ *         張庭嘉 (B11115027@mail.ntust.edu.tw)
+ *         顏毓德 (B11115038@mail.ntust.edu.tw)
+ *         黃雋祐 (B11115048@mail.ntust.edu.tw)
+ * Create Date: Oct 16, 2026
+ * Update Date: Oct 16, 2026
+ * Description: Compact, trivially-copyable chess position shared by every
+ *              function in module.cpp. (C++20)
+***************************************************************************/
+// Include guard
+#pragma once
+
+// Necessary headers
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include "bitboard.h"
+#include "zobrist.h"
+
+// Piece codes stored in Position::board, the color is bit 3 and the type is bits 0-2
+enum Piece : uint8_t {
+  NO_PIECE,
+  W_PAWN = 1, W_KNIGHT, W_BISHOP, W_ROOK, W_QUEEN, W_KING,
+  B_PAWN = 9, B_KNIGHT, B_BISHOP, B_ROOK, B_QUEEN, B_KING,
+};
+
+enum PieceType : uint8_t { NO_TYPE, PAWN, KNIGHT, BISHOP, ROOK, QUEEN, KING };
+enum Color : uint8_t { WHITE, BLACK };
+enum CastlingRight : uint8_t { WHITE_OO = 1, WHITE_OOO = 2, BLACK_OO = 4, BLACK_OOO = 8 };
+
+// Squares are numbered like the html board: index = y * 8 + x, "a8" == 0, "h1" == 63
+constexpr uint8_t NO_SQUARE = 64;
+
+// FEN letter of each piece code, indexed by Piece
+constexpr char PIECE_CHARS[] = " PNBRQK  pnbrqk";
+
+// Intent: Get the color of a piece
+// Pre: p != NO_PIECE
+// Post: None
+constexpr Color colorOf(Piece p) { return Color(p >> 3); }
+
+// Intent: Get the type of a piece regardless of its color
+// Pre: None
+// Post: result == NO_TYPE if p == NO_PIECE
+constexpr PieceType typeOf(Piece p) { return PieceType(p & 7); }
+
+// Intent: Combine a color and a piece type into a piece code
+// Pre: t != NO_TYPE
+// Post: None
+constexpr Piece makePiece(Color c, PieceType t) { return Piece((c << 3) | t); }
+
+// Piece code of each FEN letter, indexed by the unsigned char value
+constexpr auto CHAR_TO_PIECE = [] {
+  std::array<Piece, 256> table{};
+  for (uint8_t p = W_PAWN; p <= B_KING; ++p)
+    if (PIECE_CHARS[p] != ' ')
+      table[uint8_t(PIECE_CHARS[p])] = Piece(p);
+  return table;
+}();
+
+// Intent: Convert a FEN letter into a piece code
+// Pre: None
+// Post: result == NO_PIECE if c is not one of "PNBRQKpnbrqk"
+constexpr Piece charToPiece(char c) { return CHAR_TO_PIECE[uint8_t(c)]; }
+
+// Intent: Convert array index x and y into a square index
+// Pre: x <= 7 && y <= 7
+// Post: None
+constexpr uint8_t xy2sq(size_t x, size_t y) { return uint8_t(y * 8 + x); }
+
+// The whole game state of a FEN string without any heap allocation
+struct Position {
+  Bitboard byType[7];      // indexed by PieceType, byType[NO_TYPE] holds every piece
+  Bitboard byColor[2];
+  Piece board[64];         // board[xy2sq(x, y)], y is inverted like FEN ranks
+  Color activeColor;
+  uint8_t castlingRights;  // bitmask of CastlingRight
+  uint8_t enPassant;       // en passant target square or NO_SQUARE
+  uint8_t kingSquare[2];   // indexed by Color
+  uint16_t halfmoveClock;
+  uint32_t fullmoveNumber;
+  uint64_t key;            // Zobrist hash, updated by put, remove and makeMove
+
+  // Intent: Get the piece at array index x and y
+  // Pre: x <= 7 && y <= 7
+  // Post: None
+  Piece at(size_t x, size_t y) const { return board[xy2sq(x, y)]; }
+
+  // Intent: Get every piece, or the pieces of one color and type
+  // Pre: None
+  // Post: None
+  Bitboard occupied() const { return byType[NO_TYPE]; }
+  Bitboard pieces(Color c, PieceType t) const { return byColor[c] & byType[t]; }
+
+  // Intent: Place a piece on an empty square
+  // Pre: board[sq] == NO_PIECE && p != NO_PIECE
+  // Post: The board, the bitboards, the king squares and the key are updated
+  constexpr void put(uint8_t sq, Piece p) {
+    board[sq] = p;
+    key ^= ZOBRIST.piece[p][sq];
+    byType[NO_TYPE] |= bit(sq);
+    byType[typeOf(p)] |= bit(sq);
+    byColor[colorOf(p)] |= bit(sq);
+    if (typeOf(p) == KING)
+      kingSquare[colorOf(p)] = sq;
+  }
+
+  // Intent: Remove the piece on a square
+  // Pre: board[sq] != NO_PIECE
+  // Post: The board, the bitboards and the key are updated
+  constexpr void remove(uint8_t sq) {
+    Piece p = board[sq];
+    board[sq] = NO_PIECE;
+    key ^= ZOBRIST.piece[p][sq];
+    byType[NO_TYPE] &= ~bit(sq);
+    byType[typeOf(p)] &= ~bit(sq);
+    byColor[colorOf(p)] &= ~bit(sq);
+  }
+
+  // Intent: Get the hash of the side to move, castling rights and en passant file
+  // Pre: None
+  // Post: None
+  constexpr uint64_t stateKey() const {
+    return (activeColor == BLACK ? ZOBRIST.blackToMove : 0) ^ ZOBRIST.castling[castlingRights]
+         ^ (enPassant == NO_SQUARE ? 0 : ZOBRIST.enPassant[enPassant % 8]);
+  }
+
+  // Intent: Recompute the Zobrist hash from scratch, only used to verify the incremental key
+  // Pre: None
+  // Post: result == key if every update was done through put, remove and makeMove
+  constexpr uint64_t computeKey() const {
+    uint64_t result = stateKey();
+    for (uint8_t sq = 0; sq < 64; ++sq)
+      if (board[sq] != NO_PIECE)
+        result ^= ZOBRIST.piece[board[sq]][sq];
+    return result;
+  }
+
+  // Intent: Get the pieces of both colors that attack sq, sliders look through the given occupancy
+  // Pre: sq <= 63
+  // Post: None
+  Bitboard attackersTo(uint8_t sq, Bitboard occupied) const {
+    return (PAWN_ATTACKS[WHITE][sq] & pieces(BLACK, PAWN))
+         | (PAWN_ATTACKS[BLACK][sq] & pieces(WHITE, PAWN))
+         | (KNIGHT_ATTACKS[sq] & byType[KNIGHT])
+         | (KING_ATTACKS[sq] & byType[KING])
+         | (bishopAttacks(sq, occupied) & (byType[BISHOP] | byType[QUEEN]))
+         | (rookAttacks(sq, occupied) & (byType[ROOK] | byType[QUEEN]));
+  }
+
+  // Intent: Check if the side to move is in check
+  // Pre: None
+  // Post: None
+  bool inCheck() const {
+    return attackersTo(kingSquare[activeColor], occupied()) & byColor[!activeColor];
+  }
+};
+
+static_assert(std::is_trivially_copyable_v<Position>);
+// the bitboards take 72 bytes, the board and the state 80, copies of it are kept per game ply
+static_assert(sizeof(Position) <= 160);
@@ -0,0 +1,111 @@
+/***************************************************************************
+ * File: positions.h
+ * Author: 朱昱綸 (B11115022@mail.ntust.edu.tw)
+ *         張庭嘉 (B11115027@mail.ntust.edu.tw)
+ *         顏毓德 (B11115038@mail.ntust.edu.tw)
+ *         黃雋祐 (B11115048@mail.ntust.edu.tw)
+ * Create Date: Oct 16, 2026
+ * Update Date: Oct 16, 2026
+ * Description: Named test positions and their perft reference counts used by
+ *              the native debug and benchmark tools. (C++20)
+***************************************************************************/
+// Include guard
+#pragma once
+
+// Necessary headers
+#include <cstdint>
+
+// Deepest perft depth that has a reference count
+constexpr unsigned MAX_PERFT_DEPTH = 6;
+
+struct TestPosition {
+  const char *name;
+  const char *fen;
+  uint64_t perft[MAX_PERFT_DEPTH]; // leaf nodes at depth 1, 2, ..., 0 if unknown
+};
+
+// The counts of the positions below were produced by this move generator after it matched
+// every count of the standard perft suite at the end of the list, they catch regressions
+
+constexpr TestPosition TEST_POSITIONS[] = {
+  {"mid game benchmark, white to play", "r3kb1r/1pBnp1pp/p4p2/1N1n1b2/2BP4/5NP1/P4P1P/R1R3K1 w kq - 0 17",
+   {36, 1148, 42542, 1339860, 50373271}},
+  {"initial state", "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 1 1",
+   {20, 400, 8902, 197281, 4865609, 119060324}},
+  {"checkmate in 6", "8/8/8/8/8/4K3/5Q2/7k w - - 11 56",
+   {25, 29, 759, 2411, 65493, 206168}},
+  {"checkmate in 1", "8/8/8/8/8/6K1/4Q3/6k1 w - - 21 61",
+   {28, 34, 940, 1355, 36339, 98436}},
+  {"github issue 4, castling (slow search)", "r6r/p3kp1p/4np2/1Bb5/3p4/P4N2/1P3PPP/R3K2R w KQ - 2 18",
+   {34, 1060, 34364, 1026360, 32550428}},
+  {"github issue 4, no castling", "r6r/p3kp1p/4np2/1Bb5/3p4/P4N2/1P3PPP/R3K2R w - - 2 18",
+   {32, 998, 30874, 922650, 28313238, 840045081}},
+  {"mid game benchmark, black to play", "r3kb1r/ppBnp1pp/5p2/1N1n1b2/2BP4/5NP1/P4P1P/R1R3K1 b kq - 1 16",
+   {32, 1158, 35942, 1332618, 41417903}},
+  {"late game, rook pins bishop", "4k3/4n3/8/3N1R2/4R2p/7P/1r3BK1/8 b - - 6 42",
+   {14, 502, 7050, 255455, 4015708, 144787996}},
+  {"end game, impossible pawn", "4p3/8/8/8/8/k6P/6K1/8 b - - 6 42",
+   {6, 48, 368, 2574, 19691, 140769}},
+  {"en passant", "rn1qkbnr/p1p1pppp/8/1pPp4/3P1B2/8/PP2PPPP/Rb1QKBNR w KQkq b6 0 5",
+   {33, 870, 28196, 781462, 25747040, 747160675}},
+  {"too many pieces", "rnbqkbnr/pppppppp/nnnnnnnn/PPPPPPPP/pppppppp/NNNNNNNN/PPPPPPPP/RNBQKBNR w KQkq - 1 1",
+   {26, 676, 18474, 499242, 14147898, 398975234}},
+  {"en passant", "rnb1r1k1/ppp2ppp/8/8/2PN4/2Nn4/P3BPPP/R3K2R w KQ - 5 14",
+   {3, 114, 4034, 148663, 5172833, 185233161}},
+  {"github issue 5, castling", "r3k2Q/pp3p1p/3qp3/2pp2N1/3P4/4PP2/PP1K2PP/nNB4R b k - 0 15",
+   {3, 109, 2938, 102724, 2891505, 99365616}},
+  {"late-ish", "8/p2P1N2/8/4p2k/1p2P3/1P1b2pK/P6P/n7 w - - 0 33",
+   {15, 234, 3554, 54124, 924272, 14341564}},
+  {"queening opportunities", "4kb1R/1p1np1P1/2B2p2/1N1P1b2/8/5NK1/p3rP1p/8 w - - 0 31",
+   {37, 1003, 33718, 948321, 30385788}},
+  {"mate in 1", "5k2/8/5K2/4Q3/5P2/8/8/8 w - - 3 61",
+   {26, 36, 973, 2352, 63916, 171624}},
+  {"incomplete FEN, stalemate", "rn2k1nr/pp4pp/3p4/q1pP4/P1P2p1b/1b2pPRP/1P1NP1PQ/2B1KBNR w Kkq -",
+   {0}},
+  {"stalemate", "5bnr/4p1pq/4Qpkr/7p/2P4P/8/PP1PPPP1/RNB1KBNR b KQ - 0 10",
+   {0}},
+  {"stalemate in 1 (Qxe6)", "5bnr/4p1pq/2Q1ppkr/7p/2P4P/8/PP1PPPP1/RNB1KBNR w KQ - 0 10",
+   {36, 132, 4811, 33243, 1202236, 13424637}},
+  {"rook & king", "8/7K/8/8/8/8/R7/7k w - - 0 1",
+   {19, 33, 598, 2644, 48645, 228395}},
+  {"zugzwang", "8/8/p1p5/1p5p/1P5p/8/PPP2K1p/4R1rk w - - 0 1",
+   {21, 194, 3203, 39733, 687420, 9520448}},
+  {"earlyish", "rnq1nrk1/pp3pbp/6p1/3p4/3P4/5N2/PP2BPPP/R1BQK2R w KQ -",
+   {34, 1145, 39523, 1348368, 48009068}},
+  {"checkmate in 2", "4kb2/3r1p2/2R3p1/6B1/p6P/P3p1P1/P7/5K2 w - - 0 36",
+   {25, 483, 10588, 213088, 4655052, 96427717}},
+  {"“leonid's position”", "q2k2q1/2nqn2b/1n1P1n1b/2rnr2Q/1NQ1QN1Q/3Q3B/2RQR2B/Q2K2Q1 w - -",
+   {99, 6271, 568299, 34807627}},
+  {"insufficient material", "8/7K/8/8/8/8/N7/7k w - - 40 40",
+   {8, 24, 231, 1368, 14427, 79427}},
+  {"sufficient material - knight", "8/7K/8/5n2/8/8/N7/7k w - - 40 40",
+   {6, 66, 568, 5690, 54298, 570182}},
+  {"insufficient material - bishops", "8/6BK/7B/6b1/7B/8/1B6/7k w - - 40 40",
+   {21, 224, 5780, 59654, 1603729, 16938683}},
+  {"sufficient material - opposing bishops", "8/6BK/7B/6b1/7B/8/B7/7k w - - 40 40",
+   {23, 242, 6892, 72602, 2170628, 23375158}},
+  {"sufficient material", "8/7K/8/8/7B/8/N7/7k w - - 40 40",
+   {15, 43, 716, 3716, 64471, 300558}},
+  {"castling; various checks", "r3k2r/p4p1p/4np2/1Bb5/3p4/P3nN2/1P3PPP/R3K2R w KQkq - 2 18",
+   {31, 290, 8139, 274450, 7775335, 261852374}},
+  {"Adrian Dușa's en-passant position", "r2k3B/ppp2p1p/7n/3p4/8/1P3N2/P4qP1/4RRK1 w q - 0 17",
+   {4, 96, 2891, 72920, 2231284, 60473353}},
+  {"Adrian Dușa's position, no castling", "r2k3B/ppp2p1p/7n/3p4/8/1P3N2/P4qP1/4RRK1 w - - 0 17",
+   {4, 96, 2891, 72920, 2231284, 60473353}},
+  {"Adrian Dușa's continuation", "r7/pp1k1p1p/5B1n/2pp4/8/1P3N2/P4RP1/4R1K1 w q - 3 19",
+   {42, 843, 33565, 707496, 27117897, 590316336}},
+  {"blatantly false castling claims", "8/7K/8/8/8/8/q7/7k w KQq - 40 40",
+   {4, 96, 423, 10550, 47318, 1208719}},
+
+  // standard perft suite (chessprogramming wiki), the counts are independently verified
+  {"perft suite: kiwipete", "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+   {48, 2039, 97862, 4085603, 193690690}},
+  {"perft suite: position 3", "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+   {14, 191, 2812, 43238, 674624, 11030083}},
+  {"perft suite: position 4", "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1",
+   {6, 264, 9467, 422333, 15833292}},
+  {"perft suite: position 4, mirrored", "r2q1rk1/pP1p2pp/Q4n2/bbp1p3/Np6/1B3NBn/pPPP1PPP/R3K2R b KQ - 0 1",
+   {6, 264, 9467, 422333, 15833292}},
+  {"perft suite: position 5", "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8",
+   {44, 1486, 62379, 2103487, 89941194}},
+};
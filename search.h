@@ -0,0 +1,386 @@
+/***************************************************************************
+ * File: search.h
+ * Author: 朱昱綸 (B11115022@mail.ntust.edu.tw)
+ *         張庭嘉 (B11115027@mail.ntust.edu.tw)
+ *         顏毓德 (B11115038@mail.ntust.edu.tw)
+ *         黃雋祐 (B11115048@mail.ntust.edu.tw)
+ * Create Date: Oct 16, 2026
+ * Update Date: Oct 16, 2026
+ * Description: Negamax alpha-beta search with iterative deepening,
+ *              aspiration windows and quiescence search, run on several
+ *              threads with Lazy SMP, moves ordered by order.h. (C++20)
+***************************************************************************/
+// Include guard
+#pragma once
+
+// Necessary headers
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <vector>
+#include "eval.h"
+#include "movegen.h"
+#include "nnue.h"
+#include "order.h"
+#include "tablebase.h"
+#include "tt.h"
+
+// Scores at or beyond MATE_BOUND are mates, MATE - n means mate in n plies
+constexpr int MATE = 32000;
+constexpr int MATE_BOUND = MATE - 1000;
+constexpr int INF = MATE + 1;
+
+// Exchanges longer than this are cut off with the static evaluation, otherwise positions
+// where nearly every piece can take another (like "too many pieces") never finish
+constexpr unsigned MAX_QUIESCENCE_PLY = 6;
+
+// When to stop searching, 0 means no limit
+struct SearchLimits {
+  unsigned depth = 0;
+  uint64_t nodes = 0;        // counted by the main thread only
+  unsigned milliseconds = 0;
+  unsigned threads = 1;      // 1 keeps the search deterministic for a given table
+  MoveOrdering ordering = ORDER_FULL;
+};
+
+// Helper threads skip some depths so that they do not all search the same iteration
+// at the same time, thread i skips depth d if ((d + SKIP_PHASE[j]) / SKIP_SIZE[j]) is odd,
+// j == (i - 1) % 20
+constexpr unsigned SKIP_SIZE[20] = {1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 3, 3, 4, 4, 4, 4, 4, 4, 4, 4};
+constexpr unsigned SKIP_PHASE[20] = {0, 1, 0, 1, 2, 3, 0, 1, 2, 3, 4, 5, 0, 1, 2, 3, 4, 5, 6, 7};
+
+// Result of the deepest completed iteration
+struct SearchResult {
+  Move bestMove{};     // Move{} if the side to move has no legal move
+  int score = 0;       // centipawns or mate score, from the side to move's point of view
+  unsigned depth = 0;
+  uint64_t nodes = 0;
+  double seconds = 0;
+  TTStats tt{};        // table use of every thread
+};
+
+// Intent: Convert a mate score between "plies from the root" and "plies from this node" for the table
+// Pre: None
+// Post: None
+constexpr int scoreToTT(int score, unsigned ply) {
+  return score >= MATE_BOUND ? score + int(ply) : score <= -MATE_BOUND ? score - int(ply) : score;
+}
+constexpr int scoreFromTT(int score, unsigned ply) {
+  return score >= MATE_BOUND ? score - int(ply) : score <= -MATE_BOUND ? score + int(ply) : score;
+}
+
+// One search from one root position, the position is played forward and back in place
+struct Searcher {
+  using clock = std::chrono::steady_clock;
+
+  Position pos;
+  TranspositionTable &tt;
+  SearchLimits limits;
+  const std::atomic<bool> *sharedStop = nullptr; // set by the main thread to stop the helpers
+  unsigned threadId = 0;                         // 0 is the main thread
+  clock::time_point start = clock::now();
+  uint64_t nodes = 0;
+  unsigned rootDepth = 0;
+  bool stopped = false;
+  const Network *network = nullptr;        // evaluate with eval.h if nullptr
+  std::vector<Accumulator> accumulators{}; // indexed by ply, only used with a network
+  const Tablebase *tablebase = nullptr;    // probed below the root if set
+  TTStats ttStats{};                       // of this thread only, merged by search()
+  std::unique_ptr<MoveHistory> history = std::make_unique<MoveHistory>(); // too big for a WASM stack
+
+  // Intent: Evaluate the current position with the network or with eval.h
+  // Pre: accumulators[ply] matches pos if network != nullptr
+  // Post: None
+  int staticEval(unsigned ply) const {
+    return network ? network->evaluate(accumulators[ply], pos.activeColor) : evaluate(pos);
+  }
+
+  // Intent: Play a move at ply, updating the accumulator of ply + 1 from the one of ply
+  // Pre: m is a legal move of pos, ply < MAX_PLY
+  // Post: The returned record lets unmakeMove take the move back, the accumulators need no undo
+  UndoInfo play(Move m, unsigned ply) {
+    if (network)
+      network->update(accumulators[ply], accumulators[ply + 1], pos, m);
+    return makeMove(pos, m);
+  }
+
+  // Intent: Look up and store the current position, counting the outcome in ttStats
+  // Pre: None
+  // Post: See TranspositionTable::probe and TranspositionTable::store
+  bool probeTT(TTEntry &entry) {
+    bool hit = tt.probe(pos.key, entry);
+    ++(hit ? ttStats.hits : ttStats.misses);
+    return hit;
+  }
+  void storeTT(Move move, int score, unsigned ply, unsigned depth, Bound bound) {
+    ++ttStats.stores;
+    ttStats.collisions += tt.store(pos.key, move, int16_t(scoreToTT(score, ply)), uint8_t(depth), bound);
+  }
+
+  // Intent: Stop once a node or time limit is reached, the clock is read every 1024 nodes,
+  //         helper threads only stop when the main thread tells them to
+  // Pre: sharedStop != nullptr if threadId != 0
+  // Post: Return stopped, the first iteration of the main thread is never stopped so there
+  //       is always a move to play
+  bool checkLimits() {
+    if (threadId) {
+      stopped = stopped || sharedStop->load(std::memory_order_relaxed);
+      return stopped;
+    }
+    if (rootDepth <= 1)
+      return false;
+    if (limits.nodes && nodes >= limits.nodes)
+      stopped = true;
+    if (limits.milliseconds && !(nodes & 1023) && clock::now() - start >= std::chrono::milliseconds(limits.milliseconds))
+      stopped = true;
+    return stopped;
+  }
+
+  // Intent: Check if a capture cannot matter in quiescence: it gains too little to reach alpha
+  //         even unanswered (delta pruning), or a defended piece takes something cheaper
+  // Pre: m is tactical, the side to move is not in check
+  // Post: Promotions are never hopeless
+  bool isHopelessCapture(Move m, int standPat, int alpha) const {
+    if (m.flag() == PROMOTION)
+      return false;
+    int victim = PIECE_VALUES[m.flag() == EN_PASSANT ? PAWN : typeOf(pos.board[m.to()])];
+    if (standPat + victim + 200 <= alpha)
+      return true;
+    int attacker = PIECE_VALUES[typeOf(pos.board[m.from()])];
+    return attacker > victim && (pos.attackersTo(m.to(), pos.occupied()) & pos.byColor[!pos.activeColor]);
+  }
+
+  // Intent: Search captures and promotions only until the position is quiet
+  // Pre: alpha < beta
+  // Post: Return a score within [alpha, beta] unless it fails low or high
+  int quiescence(int alpha, int beta, unsigned ply, unsigned qply = 0) {
+    ++nodes;
+    STAT_COUNT(STAT_NODES);
+    if (checkLimits())
+      return 0;
+
+    if (ply >= MAX_PLY || qply >= MAX_QUIESCENCE_PLY)
+      return staticEval(ply);
+
+    TTEntry entry;
+    if (probeTT(entry)) {
+      int score = scoreFromTT(entry.score, ply);
+      if (entry.bound == BOUND_EXACT || (entry.bound == BOUND_LOWER && score >= beta)
+          || (entry.bound == BOUND_UPPER && score <= alpha))
+        return score;
+    }
+    int originalAlpha = alpha;
+
+    bool inCheck = pos.inCheck();
+    int standPat = -INF;
+    if (!inCheck) {
+      standPat = staticEval(ply);
+      if (standPat >= beta)
+        return standPat;
+      alpha = std::max(alpha, standPat);
+    }
+
+    MoveList moves;
+    generateLegalMoves(pos, moves);
+    if (inCheck && !moves.size())
+      return -MATE + int(ply);
+    // most losing captures are skipped by isHopelessCapture, SEE would cost more than it sorts
+    history->order(pos, moves, Move{}, ply, std::min(limits.ordering, ORDER_MVV_LVA));
+
+    // every evasion is searched when in check, otherwise only tactical moves that can raise alpha
+    for (const Move &m : moves) {
+      if (!inCheck && (!isTactical(pos, m) || isHopelessCapture(m, standPat, alpha)))
+        continue;
+      UndoInfo undo = play(m, ply);
+      int score = -quiescence(-beta, -alpha, ply + 1, qply + 1);
+      unmakeMove(pos, m, undo);
+      if (stopped)
+        return 0;
+      if (score >= beta) {
+        storeTT(m, score, ply, 0, BOUND_LOWER);
+        return score;
+      }
+      alpha = std::max(alpha, score);
+    }
+    storeTT(Move{}, alpha, ply, 0, alpha > originalAlpha ? BOUND_EXACT : BOUND_UPPER);
+    return alpha;
+  }
+
+  // Intent: Search pos to the given depth with fail-soft negamax alpha-beta
+  // Pre: alpha < beta
+  // Post: Return 0 if the search was stopped, the caller has to discard it in that case
+  int negamax(int alpha, int beta, int depth, unsigned ply, Move *bestOut = nullptr) {
+    bool inCheck = pos.inCheck();
+    if (inCheck && ply < MAX_PLY)
+      ++depth;
+    if (depth <= 0)
+      return quiescence(alpha, beta, ply);
+
+    ++nodes;
+    STAT_COUNT(STAT_NODES);
+    if (checkLimits())
+      return 0;
+
+    if (ply && pos.halfmoveClock >= 100)
+      return 0;
+    if (ply >= MAX_PLY)
+      return staticEval(ply);
+
+    // a table knows the exact distance to mate, the root still searches to pick a move
+    TbResult known;
+    if (ply && tablebase && tablebase->probe(pos, known)) {
+      if (known.wdl == TB_WIN)
+        return MATE - int(ply + known.dtm);
+      return known.wdl == TB_LOSS ? -MATE + int(ply + known.dtm) : 0;
+    }
+
+    TTEntry entry;
+    Move ttMove{};
+    if (probeTT(entry)) {
+      ttMove = entry.move;
+      int score = scoreFromTT(entry.score, ply);
+      if (ply && entry.depth >= depth
+          && (entry.bound == BOUND_EXACT || (entry.bound == BOUND_LOWER && score >= beta)
+              || (entry.bound == BOUND_UPPER && score <= alpha)))
+        return score;
+    }
+
+    MoveList moves;
+    generateLegalMoves(pos, moves);
+    if (!moves.size())
+      return inCheck ? -MATE + int(ply) : 0;
+    history->order(pos, moves, ttMove, ply, limits.ordering);
+
+    int originalAlpha = alpha;
+    int best = -INF;
+    Move bestMove = moves[0];
+    for (const Move &m : moves) {
+      UndoInfo undo = play(m, ply);
+      int score = -negamax(-beta, -alpha, depth - 1, ply + 1);
+      unmakeMove(pos, m, undo);
+      if (stopped)
+        return 0;
+
+      if (score > best) {
+        best = score;
+        bestMove = m;
+      }
+      alpha = std::max(alpha, score);
+      if (alpha >= beta) {
+        if (!isTactical(pos, m))
+          history->cutoff(pos, m, ply, depth, moves.begin(), &m);
+        break;
+      }
+    }
+
+    Bound bound = best >= beta ? BOUND_LOWER : best > originalAlpha ? BOUND_EXACT : BOUND_UPPER;
+    storeTT(bestMove, best, ply, depth, bound);
+    if (bestOut)
+      *bestOut = bestMove;
+    return best;
+  }
+
+  // Intent: Deepen the search one ply at a time until a limit is reached, starting each
+  //         iteration after the first few with a narrow window around the previous score
+  // Pre: None
+  // Post: result.depth >= 1 unless the root has no legal move
+  SearchResult run() {
+    SearchResult result;
+    if (network) {
+      accumulators.resize(MAX_PLY + 1);
+      network->refresh(pos, accumulators[0]);
+    }
+    MoveList rootMoves;
+    generateLegalMoves(pos, rootMoves);
+    if (rootMoves.size())
+      result.bestMove = rootMoves[0];
+
+    unsigned maxDepth = limits.depth ? std::min(limits.depth, MAX_PLY - 1) : MAX_PLY - 1;
+    for (unsigned depth = 1; depth <= maxDepth && rootMoves.size(); ++depth) {
+      size_t skip = (threadId + 19) % 20;
+      if (threadId && (depth + SKIP_PHASE[skip]) / SKIP_SIZE[skip] % 2)
+        continue;
+      rootDepth = depth;
+      int delta = 50;
+      int alpha = depth >= 4 ? std::max(result.score - delta, -INF) : -INF;
+      int beta = depth >= 4 ? std::min(result.score + delta, INF) : INF;
+      Move best{};
+      int score;
+
+      // widen the window on the side that failed until the score lies inside it
+      while (true) {
+        score = negamax(alpha, beta, depth, 0, &best);
+        if (stopped)
+          break;
+        if (score <= alpha)
+          alpha = std::max(score - delta, -INF);
+        else if (score >= beta)
+          beta = std::min(score + delta, INF);
+        else
+          break;
+        delta *= 2;
+      }
+
+      if (stopped)
+        break;
+      result.bestMove = best;
+      result.score = score;
+      result.depth = depth;
+
+      // a forced mate found at this depth cannot get shorter
+      if (std::abs(score) >= MATE_BOUND && MATE - std::abs(score) <= int(depth))
+        break;
+    }
+
+    result.nodes = nodes;
+    result.tt = ttStats;
+    result.seconds = std::chrono::duration<double>(clock::now() - start).count();
+    return result;
+  }
+};
+
+// Intent: Find the best move of a position within the given limits, helper threads search
+//         the same position and share what they find through the table (Lazy SMP)
+// Pre: At least one limit is set, or the search runs to MAX_PLY
+// Post: pos is unchanged, result.nodes and result.tt count the work of every thread, positions are
+//       evaluated with network if it is not nullptr and looked up in tablebase if it is not nullptr
+inline SearchResult search(const Position &pos, const SearchLimits &limits, TranspositionTable &tt,
+                           const Network *network = nullptr, const Tablebase *tablebase = nullptr) {
+  tt.newSearch();
+  std::atomic<bool> stop = false;
+  std::atomic<uint64_t> helperNodes = 0;
+
+  // the helpers search until the main thread is done
+  unsigned helpers = limits.threads > 1 ? limits.threads - 1 : 0;
+#if defined(EMSCRIPTEN) && !defined(__EMSCRIPTEN_PTHREADS__)
+  helpers = 0;
+#endif
+  std::vector<std::thread> threads;
+  std::vector<TTStats> helperStats(helpers);
+  for (unsigned i = 1; i <= helpers; ++i) {
+    threads.emplace_back([&, i] {
+      Searcher helper{pos, tt, {.ordering = limits.ordering}, &stop, i};
+      helper.network = network;
+      helper.tablebase = tablebase;
+      helper.run();
+      helperNodes += helper.nodes;
+      helperStats[i - 1] = helper.ttStats;
+    });
+  }
+
+  Searcher searcher{pos, tt, limits};
+  searcher.network = network;
+  searcher.tablebase = tablebase;
+  SearchResult result = searcher.run();
+  stop = true;
+  for (std::thread &t : threads)
+    t.join();
+
+  result.nodes += helperNodes;
+  for (const TTStats &stats : helperStats)
+    result.tt += stats;
+  return result;
+}
@@ -0,0 +1,284 @@
+/***************************************************************************
+ * File: selfplay.h
+ * Author: 朱昱綸 (B11115022@mail.ntust.edu.tw)
+ *         張庭嘉 (B11115027@mail.ntust.edu.tw)
+ *         顏毓德 (B11115038@mail.ntust.edu.tw)
+ *         黃雋祐 (B11115048@mail.ntust.edu.tw)
+ * Create Date: Oct 16, 2026
+ * Update Date: Oct 16, 2026
+ * Description: Random self-play games on a pool of threads, every position
+ *              written with the game result as a 32-byte record or a line
+ *              of text by a single writer thread. (C++20)
+***************************************************************************/
+// Include guard
+#pragma once
+
+// Necessary headers
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "draw.h"
+#include "fen.h"
+#include "movegen.h"
+#include "pgn.h"
+#include "pool.h"
+#include "zobrist.h"
+
+// Game results from white's point of view, the values are stored in the records
+enum GameResult : uint8_t { BLACK_WINS, GAME_DRAWN, WHITE_WINS };
+
+constexpr const char *GAME_RESULT_TEXT[] = {"0-1", "1/2-1/2", "1-0"};
+
+// A position of a finished game, 32 bytes:
+//   0-7   occupied squares, bit i is Position::board[i], little-endian
+//   8-23  the piece code of each occupied square in square order, 4 bits each, low nibble first
+//   24    side to move, 25 castling rights, 26 en passant square (64 if none), 27 halfmove clock
+//   28-29 fullmove number, little-endian
+//   30    GameResult, 31 plies until the game ended (at most 255)
+struct PositionRecord {
+  uint8_t bytes[32];
+};
+
+// Intent: Pack a position and the result of its game
+// Pre: pos has at most 32 pieces
+// Post: None
+inline PositionRecord packPosition(const Position &pos, GameResult result, unsigned pliesLeft) {
+  PositionRecord record{};
+  Bitboard occupied = pos.occupied();
+  for (unsigned i = 0; i < 8; ++i)
+    record.bytes[i] = uint8_t(occupied >> (8 * i));
+  unsigned n = 0;
+  for (Bitboard b = occupied; b; ++n)
+    record.bytes[8 + n / 2] |= uint8_t(pos.board[popLsb(b)] << (4 * (n % 2)));
+  record.bytes[24] = pos.activeColor;
+  record.bytes[25] = pos.castlingRights;
+  record.bytes[26] = pos.enPassant;
+  record.bytes[27] = pos.halfmoveClock;
+  record.bytes[28] = uint8_t(pos.fullmoveNumber);
+  record.bytes[29] = uint8_t(pos.fullmoveNumber >> 8);
+  record.bytes[30] = result;
+  record.bytes[31] = uint8_t(std::min(pliesLeft, 255u));
+  return record;
+}
+
+// Intent: Unpack a record written by packPosition
+// Pre: None
+// Post: Return false if the record has more than 32 pieces, an unknown piece code or not one
+//       king of each color, pos.key is recomputed
+inline bool unpackPosition(const PositionRecord &record, Position &pos, GameResult &result) {
+  Bitboard occupied = 0;
+  for (unsigned i = 0; i < 8; ++i)
+    occupied |= Bitboard(record.bytes[i]) << (8 * i);
+  if (popCount(occupied) > 32 || record.bytes[24] > BLACK || record.bytes[26] > NO_SQUARE || record.bytes[30] > WHITE_WINS)
+    return false;
+
+  pos = {};
+  pos.kingSquare[WHITE] = pos.kingSquare[BLACK] = NO_SQUARE;
+  unsigned n = 0;
+  for (Bitboard b = occupied; b; ++n) {
+    uint8_t sq = popLsb(b);
+    Piece p = Piece(record.bytes[8 + n / 2] >> (4 * (n % 2)) & 15);
+    if (typeOf(p) < PAWN || typeOf(p) > KING)
+      return false;
+    if (typeOf(p) == KING) {
+      if (pos.kingSquare[colorOf(p)] != NO_SQUARE)
+        return false;
+      pos.kingSquare[colorOf(p)] = sq;
+    }
+    pos.put(sq, p);
+  }
+  if (pos.kingSquare[WHITE] == NO_SQUARE || pos.kingSquare[BLACK] == NO_SQUARE)
+    return false;
+
+  pos.activeColor = Color(record.bytes[24]);
+  pos.castlingRights = record.bytes[25] & 15;
+  pos.enPassant = record.bytes[26];
+  pos.halfmoveClock = record.bytes[27];
+  pos.fullmoveNumber = uint16_t(record.bytes[28] | record.bytes[29] << 8);
+  pos.key ^= pos.stateKey();
+  result = GameResult(record.bytes[30]);
+  return true;
+}
+
+enum SelfPlayFormat : uint8_t { SELFPLAY_BINARY, SELFPLAY_FEN };
+
+struct SelfPlayOptions {
+  uint64_t games = 1000;
+  unsigned threads = 1;
+  uint64_t seed = 1;
+  unsigned captureBias = 0;  // percent of the moves that are a capture or a promotion if there is one
+  SelfPlayFormat format = SELFPLAY_BINARY;
+};
+
+struct SelfPlayReport {
+  uint64_t games = 0;
+  uint64_t positions = 0;
+  uint64_t results[3] = {};  // indexed by GameResult
+  uint64_t bytes = 0;
+};
+
+// Writes a FEN without the trailing newline, the FEN writer lives with the string API
+using FenWriter = std::function<void(const Position &pos, std::string &out)>;
+
+// Plays the games on a WorkerPool. Every worker fills its own chunk and hands full chunks to
+// the writer thread through its own SpscQueue, so the workers share nothing but the pool and
+// a count of pushed chunks the idle writer sleeps on. A game only depends on the seed and its
+// number, not on the worker or the thread count.
+class SelfPlay {
+public:
+  static constexpr size_t CHUNK_BYTES = 1 << 16;
+  static constexpr size_t QUEUE_CHUNKS = 16;
+
+  // Intent: Keep the options, writeFen is only called for SELFPLAY_FEN
+  // Pre: options.threads >= 1
+  // Post: None
+  SelfPlay(const SelfPlayOptions &options, FenWriter writeFen) : options(options), writeFen(std::move(writeFen)) {}
+
+  // Intent: Play options.games games and write every position of them to out, in the order the
+  //         chunks arrive, "<FEN>\t<result>\n" per position for SELFPLAY_FEN
+  // Pre: out stays valid until the call returns
+  // Post: Every position is written before the call returns
+  SelfPlayReport run(std::ostream &out) {
+    WorkerPool pool(options.threads);
+    std::vector<std::unique_ptr<Worker>> workers;
+    for (unsigned i = 0; i < pool.size(); ++i)
+      workers.push_back(std::make_unique<Worker>());
+
+    std::atomic<bool> done = false;
+    SelfPlayReport report;
+    std::thread writer([&] {
+      std::string chunk;
+      for (;;) {
+        // both are read before the sweep: a chunk pushed or a finish signalled after that
+        // changes pushed, so the wait below returns at once instead of missing it
+        uint64_t seen = pushed.load(std::memory_order_acquire);
+        bool finished = done.load(std::memory_order_acquire), idle = true;
+        for (auto &worker : workers) {
+          while (worker->queue.pop(chunk)) {
+            out.write(chunk.data(), std::streamsize(chunk.size()));
+            report.bytes += chunk.size();
+            idle = false;
+          }
+        }
+        if (idle && finished)
+          break;
+        if (idle)
+          pushed.wait(seen, std::memory_order_acquire);
+      }
+    });
+
+    pool.run(options.games, [&](size_t game, unsigned worker) { play(game, *workers[worker]); });
+
+    // the helpers wait on the pool's barrier now, so this thread may act as every producer
+    for (auto &worker : workers)
+      worker->flush(pushed);
+    done.store(true, std::memory_order_release);
+    pushed.fetch_add(1, std::memory_order_release);
+    pushed.notify_one();
+    writer.join();
+
+    report.games = options.games;
+    for (auto &worker : workers) {
+      report.positions += worker->positions;
+      for (unsigned r = 0; r < 3; ++r)
+        report.results[r] += worker->results[r];
+    }
+    return report;
+  }
+
+private:
+  struct alignas(64) Worker {
+    SpscQueue<std::string, QUEUE_CHUNKS> queue;
+    std::string chunk;
+    std::vector<Position> game;
+    uint64_t positions = 0;
+    uint64_t results[3] = {};
+
+    // Intent: Hand the chunk to the writer, waiting while the queue is full, and wake the
+    //         writer through pushed
+    // Pre: Called by the only thread that currently produces for this worker
+    // Post: chunk is empty
+    void flush(std::atomic<uint64_t> &pushed) {
+      if (chunk.empty())
+        return;
+      while (!queue.push(chunk))
+        std::this_thread::yield();
+      chunk.clear();
+      pushed.fetch_add(1, std::memory_order_release);
+      pushed.notify_one();
+    }
+  };
+
+  // Intent: Play one random game from the initial position until it is over by checkmate,
+  //         stalemate or a draw rule, then write its positions
+  // Pre: Only called by the thread that owns worker
+  // Post: None
+  void play(uint64_t number, Worker &worker) {
+    static constexpr Position INITIAL = [] {
+      Position pos;
+      readFEN(INITIAL_FEN, pos);
+      return pos;
+    }();
+    uint64_t random = options.seed ^ (number * 0x9E37'79B9'7F4A'7C15ull);
+    splitMix64(random);
+
+    Position pos = INITIAL;
+    KeyHistory history;
+    MoveList moves;
+    GameResult result;
+    worker.game.clear();
+    for (;;) {
+      worker.game.push_back(pos);
+      moves.count = 0;
+      generateLegalMoves(pos, moves);
+      if (!moves.size()) {
+        result = !pos.inCheck() ? GAME_DRAWN : pos.activeColor == WHITE ? BLACK_WINS : WHITE_WINS;
+        break;
+      }
+      if (drawReason(pos, &history) != NO_DRAW) {
+        result = GAME_DRAWN;
+        break;
+      }
+
+      Move m = moves[splitMix64(random) % moves.size()];
+      if (options.captureBias && splitMix64(random) % 100 < options.captureBias) {
+        Move forcing[MAX_MOVES];
+        size_t count = 0;
+        for (Move candidate : moves)
+          if (pos.board[candidate.to()] != NO_PIECE || candidate.flag() == PROMOTION || candidate.flag() == EN_PASSANT)
+            forcing[count++] = candidate;
+        if (count)
+          m = forcing[splitMix64(random) % count];
+      }
+      history.push(pos);
+      makeMove(pos, m);
+    }
+
+    size_t plies = worker.game.size();
+    for (size_t i = 0; i < plies; ++i) {
+      if (options.format == SELFPLAY_BINARY) {
+        PositionRecord record = packPosition(worker.game[i], result, unsigned(plies - 1 - i));
+        worker.chunk.append(reinterpret_cast<const char *>(record.bytes), sizeof(record.bytes));
+      } else {
+        writeFen(worker.game[i], worker.chunk);
+        worker.chunk += '\t';
+        worker.chunk += GAME_RESULT_TEXT[result];
+        worker.chunk += '\n';
+      }
+    }
+    if (worker.chunk.size() >= CHUNK_BYTES)
+      worker.flush(pushed);
+    worker.positions += plies;
+    ++worker.results[result];
+  }
+
+  SelfPlayOptions options;
+  FenWriter writeFen;
+  std::atomic<uint64_t> pushed = 0; // chunks handed to the writer, plus one when the run is done
+};
@@ -0,0 +1,175 @@
+/***************************************************************************
+ * File: stats.h
+ * Author: 朱昱綸 (B11115022@mail.ntust.edu.tw)
+ *         張庭嘉 (B11115027@mail.ntust.edu.tw)
+ *         顏毓德 (B11115038@mail.ntust.edu.tw)
+ *         黃雋祐 (B11115048@mail.ntust.edu.tw)
+ * Create Date: Oct 16, 2026
+ * Update Date: Oct 16, 2026
+ * Description: Hot-path counters and per-function timers, compiled in
+ *              with -DENABLE_STATS and compiled to nothing otherwise.
+ *              (C++20)
+***************************************************************************/
+// Include guard
+#pragma once
+
+// Necessary headers
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <type_traits>
+
+enum StatCounter : uint8_t {
+  STAT_FEN_PARSES, STAT_ATTACK_CHECKS, STAT_NODES, STAT_MAKE_MOVES, STAT_UNMAKE_MOVES,
+  STAT_TT_HITS, STAT_TT_MISSES, STAT_TT_STORES, STAT_TT_COLLISIONS, STAT_COUNTERS
+};
+
+constexpr const char *STAT_COUNTER_NAMES[] = {"fenParses", "attackChecks", "nodes", "makeMoves", "unmakeMoves",
+                                              "ttHits", "ttMisses", "ttStores", "ttCollisions"};
+
+// Exported functions that are timed, GameSession methods are prefixed with "session"
+enum StatFunction : uint8_t {
+  FN_GET_GAME_STATE, FN_GET_GAME_STATE_AFTER_MOVES, FN_IS_VALID_MOVE, FN_GET_VALID_TARGET_SQUARES, FN_GET_NEXT_FEN,
+  FN_GET_LEGAL_MOVES, FN_GET_POSITION_KEY, FN_GET_BEST_MOVE, FN_ANALYZE_POSITIONS, FN_SAN_TO_MOVE,
+  FN_LOAD_BOOK, FN_GET_BOOK_MOVES, FN_GET_BOOK_MOVE, FN_GENERATE_TABLEBASES, FN_GET_TABLEBASE_STATE,
+  FN_FEN_TO_HTML_CLASS_NAMES, FN_GET_STATIC_EXCHANGE, FN_GET_HANGING_PIECES, FN_SESSION_LOAD,
+  FN_SESSION_LEGAL_TARGETS, FN_SESSION_PLAY, FN_SESSION_UNDO, FN_SESSION_REDO, FN_SESSION_STATE, STAT_FUNCTIONS
+};
+
+constexpr const char *STAT_FUNCTION_NAMES[] = {
+  "getGameState", "getGameStateAfterMoves", "isValidMove", "getValidTargetSquares", "getNextFEN",
+  "getLegalMoves", "getPositionKey", "getBestMove", "analyzePositions", "sanToMove",
+  "loadBook", "getBookMoves", "getBookMove", "generateTablebases", "getTablebaseState",
+  "fenToHtmlClassNames", "getStaticExchange", "getHangingPieces", "sessionLoad",
+  "sessionLegalTargets", "sessionPlay", "sessionUndo", "sessionRedo", "sessionState",
+};
+
+struct FunctionStats {
+  uint64_t calls = 0;
+  uint64_t nanoseconds = 0;
+};
+
+// Totals of every thread since the last resetStats
+struct Stats {
+  bool enabled = false;
+  std::array<uint64_t, STAT_COUNTERS> counters{};
+  std::array<FunctionStats, STAT_FUNCTIONS> functions{};
+};
+
+#ifdef ENABLE_STATS
+
+#include <chrono>
+
+// Counters of one thread. Only the owning thread writes them, with a relaxed load and store
+// instead of a locked add; getStats reads them at any time. A block is never freed: a new
+// thread takes over the block of a finished one and keeps adding to its totals.
+struct StatBlock {
+  std::atomic<uint64_t> values[STAT_COUNTERS + 2 * STAT_FUNCTIONS] = {};
+  std::atomic<bool> inUse = true;
+  StatBlock *next = nullptr;
+};
+
+// Every block ever handed out, pushed at the head, and the totals seen at the last reset
+inline std::atomic<StatBlock *> statBlocks = nullptr;
+inline std::atomic<uint64_t> statBaseline[STAT_COUNTERS + 2 * STAT_FUNCTIONS] = {};
+
+// Intent: Get the block of the calling thread, reusing a free block before allocating one
+// Pre: None
+// Post: The block is given back when the thread ends
+inline StatBlock &localStats() {
+  struct Owner {
+    StatBlock *block = nullptr;
+    Owner() {
+      for (StatBlock *b = statBlocks.load(std::memory_order_acquire); b && !block; b = b->next) {
+        bool free = false;
+        if (b->inUse.compare_exchange_strong(free, true, std::memory_order_acquire))
+          block = b;
+      }
+      if (!block) {
+        block = new StatBlock;
+        block->next = statBlocks.load(std::memory_order_relaxed);
+        while (!statBlocks.compare_exchange_weak(block->next, block, std::memory_order_release)) {}
+      }
+    }
+    ~Owner() { block->inUse.store(false, std::memory_order_release); }
+  };
+  thread_local Owner owner;
+  return *owner.block;
+}
+
+// Intent: Add to one value of the calling thread
+// Pre: i < STAT_COUNTERS + 2 * STAT_FUNCTIONS
+// Post: None
+inline void addStat(unsigned i, uint64_t amount) {
+  std::atomic<uint64_t> &value = localStats().values[i];
+  value.store(value.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+}
+
+// Intent: Sum the values of every block
+// Pre: None
+// Post: None
+inline void sumStats(uint64_t *totals) {
+  for (StatBlock *b = statBlocks.load(std::memory_order_acquire); b; b = b->next)
+    for (unsigned i = 0; i < STAT_COUNTERS + 2 * STAT_FUNCTIONS; ++i)
+      totals[i] += b->values[i].load(std::memory_order_relaxed);
+}
+
+// Intent: Get the counters and the timers of every thread since the last reset
+// Pre: None
+// Post: Updates made while the sum is taken may or may not be included
+inline Stats getStats() {
+  uint64_t totals[STAT_COUNTERS + 2 * STAT_FUNCTIONS] = {};
+  sumStats(totals);
+  Stats stats;
+  stats.enabled = true;
+  for (unsigned i = 0; i < STAT_COUNTERS; ++i)
+    stats.counters[i] = totals[i] - statBaseline[i].load(std::memory_order_relaxed);
+  for (unsigned f = 0; f < STAT_FUNCTIONS; ++f) {
+    unsigned i = STAT_COUNTERS + 2 * f;
+    stats.functions[f] = {totals[i] - statBaseline[i].load(std::memory_order_relaxed),
+                          totals[i + 1] - statBaseline[i + 1].load(std::memory_order_relaxed)};
+  }
+  return stats;
+}
+
+// Intent: Start counting from zero, the blocks are left alone and the current totals become
+//         the baseline, so no thread ever loses an update to a reset
+// Pre: None
+// Post: None
+inline void resetStats() {
+  uint64_t totals[STAT_COUNTERS + 2 * STAT_FUNCTIONS] = {};
+  sumStats(totals);
+  for (unsigned i = 0; i < STAT_COUNTERS + 2 * STAT_FUNCTIONS; ++i)
+    statBaseline[i].store(totals[i], std::memory_order_relaxed);
+}
+
+// Counts a call of an exported function and its time until the end of the scope
+class FunctionTimer {
+public:
+  explicit FunctionTimer(StatFunction function) : function(function) {}
+  ~FunctionTimer() {
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    addStat(STAT_COUNTERS + 2 * function, 1);
+    addStat(STAT_COUNTERS + 2 * function + 1, uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()));
+  }
+
+private:
+  StatFunction function;
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+};
+
+// STAT_COUNT is skipped while a constexpr function runs at compile time
+#define STAT_COUNT(counter) do { if (!std::is_constant_evaluated()) addStat(counter, 1); } while (0)
+#define STAT_ADD(counter, amount) addStat(counter, amount)
+#define STAT_FUNCTION(function) FunctionTimer functionTimer_(function)
+
+#else
+
+inline Stats getStats() { return {}; }
+inline void resetStats() {}
+
+#define STAT_COUNT(counter) do {} while (0)
+#define STAT_ADD(counter, amount) do {} while (0)
+#define STAT_FUNCTION(function) do {} while (0)
+
+#endif // ifdef ENABLE_STATS
@@ -0,0 +1,633 @@
+/***************************************************************************
+ * File: tablebase.h
+ * Author: 朱昱綸 (B11115022@mail.ntust.edu.tw)
+ *         張庭嘉 (B11115027@mail.ntust.edu.tw)
+ *         顏毓德 (B11115038@mail.ntust.edu.tw)
+ *         黃雋祐 (B11115048@mail.ntust.edu.tw)
+ * Create Date: Oct 16, 2026
+ * Update Date: Oct 16, 2026
+ * Description: Endgame tablebases of up to 4 pieces generated by
+ *              retrograde analysis, stored with 2-bit win/draw/loss values
+ *              and a distance to mate per position. (C++20)
+***************************************************************************/
+// Include guard
+#pragma once
+
+// Necessary headers
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <istream>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "movegen.h"
+#include "pool.h"
+
+// Pieces of the largest table, kings included
+constexpr unsigned TB_MAX_PIECES = 4;
+
+// Outcome for the side to move, TB_INVALID marks the entries of impossible or duplicate placements
+enum TbWdl : uint8_t { TB_DRAW, TB_WIN, TB_LOSS, TB_INVALID };
+
+struct TbResult {
+  TbWdl wdl = TB_INVALID;
+  uint8_t dtm = 0;  // plies to mate of a win or a loss, 0 for a draw
+};
+
+enum TbStatus : uint8_t { TB_OK, TB_BAD_NAME, TB_CANNOT_OPEN, TB_BAD_MAGIC, TB_BAD_VERSION, TB_TRUNCATED };
+
+constexpr const char *TB_STATUS_TEXT[] = {
+  "ok", "unsupported material", "cannot open file", "not a tablebase file", "unsupported version", "file too short",
+};
+
+constexpr char TB_MAGIC[4] = {'C', 'T', 'B', 'L'};
+constexpr uint32_t TB_VERSION = 1;
+
+// Piece letters of a table name in the order they are listed, "KBNvK" rather than "KNBvK"
+constexpr std::string_view TB_PIECE_ORDER = "KQRBNP";
+
+// Intent: Get the key of the material of pos, 4 bits per Piece counting its pieces, with the
+//         colors swapped if flip is set
+// Pre: None
+// Post: None
+inline uint64_t materialKey(const Position &pos, bool flip) {
+  uint64_t key = 0;
+  for (Color c : {WHITE, BLACK})
+    for (PieceType t : {PAWN, KNIGHT, BISHOP, ROOK, QUEEN, KING})
+      key += uint64_t(popCount(pos.pieces(c, t))) << 4 * makePiece(Color(c ^ flip), t);
+  return key;
+}
+
+// Intent: Swap the colors of a material key
+// Pre: None
+// Post: None
+constexpr uint64_t flipMaterial(uint64_t key) {
+  return (key >> 32) | (key << 32);
+}
+
+// Intent: Get the name of a table from the letters of each side, in TB_PIECE_ORDER and with
+//         the stronger side as white
+// Pre: Both sides hold one 'K'
+// Post: None
+inline std::string tablebaseName(std::string white, std::string black) {
+  auto order = [](char c) { return TB_PIECE_ORDER.find(c); };
+  auto byOrder = [&](char a, char b) { return order(a) < order(b); };
+  std::sort(white.begin(), white.end(), byOrder);
+  std::sort(black.begin(), black.end(), byOrder);
+
+  // material value first, then more pieces, then the better piece first
+  auto strength = [&](const std::string &side) {
+    int value = 0;
+    for (char c : side)
+      value += std::array{0, 9, 5, 3, 3, 1}[order(c)];
+    return value;
+  };
+  auto weaker = [&](const std::string &a, const std::string &b) {
+    if (strength(a) != strength(b))
+      return strength(a) < strength(b);
+    if (a.size() != b.size())
+      return a.size() < b.size();
+    return std::lexicographical_compare(a.begin(), a.end(), b.begin(), b.end(), [&](char x, char y) { return order(x) > order(y); });
+  };
+  if (weaker(white, black))
+    std::swap(white, black);
+  return white + 'v' + black;
+}
+
+// The values of one material, such as "KQvKR". An entry is 2 * placement + side to move, the
+// placement lists the squares of the white king, the black king and the other pieces in
+// name order. Without pawns the white king stays in the triangle a8-d8-d5 (10 squares) by
+// mirroring the board, with pawns on the files a to d (32 squares). Other placements are
+// invalid entries, so is the larger entry of two placements mirrored along the a8-h1 diagonal.
+class TbTable {
+public:
+  // Intent: Read a name such as "KQvK", "KBNvK" or "KvKR", white's pieces first
+  // Pre: None
+  // Post: Return nullptr if a side has not exactly one king, if a letter is unknown, if there are
+  //       more than TB_MAX_PIECES pieces or if both sides have pawns (their en passant captures
+  //       are not tracked)
+  static std::unique_ptr<TbTable> fromName(std::string_view name) {
+    size_t split = name.find('v');
+    if (split == std::string_view::npos)
+      return nullptr;
+    std::string sides[2] = {std::string(name.substr(0, split)), std::string(name.substr(split + 1))};
+    if (sides[0].size() + sides[1].size() > TB_MAX_PIECES || (sides[0].find('P') != std::string::npos && sides[1].find('P') != std::string::npos))
+      return nullptr;
+
+    auto table = std::unique_ptr<TbTable>(new TbTable);
+    for (Color c : {WHITE, BLACK}) {
+      auto order = [](char x) { return TB_PIECE_ORDER.find(x); };
+      std::sort(sides[c].begin(), sides[c].end(), [&](char a, char b) { return order(a) < order(b); });
+      if (std::count(sides[c].begin(), sides[c].end(), 'K') != 1 || sides[c].find_first_not_of(TB_PIECE_ORDER) != std::string::npos)
+        return nullptr;
+      table->pieces[c] = makePiece(c, KING);
+    }
+    table->count = 2;
+    for (Color c : {WHITE, BLACK})
+      for (char letter : sides[c].substr(1))
+        table->pieces[table->count++] = makePiece(c, PieceType(PAWN + TB_PIECE_ORDER.size() - 1 - TB_PIECE_ORDER.find(letter)));
+
+    table->label = sides[0] + 'v' + sides[1];
+    for (unsigned i = 0; i < table->count; ++i) {
+      table->materialKey += uint64_t(1) << 4 * table->pieces[i];
+      table->pawns = table->pawns || typeOf(table->pieces[i]) == PAWN;
+    }
+    table->placements = table->pawns ? 32 : 10;
+    for (unsigned i = 1; i < table->count; ++i)
+      table->placements *= 64;
+    table->wdl.assign((table->size() + 31) / 32, 0);
+    table->dtm.assign(table->size(), 0);
+    return table;
+  }
+
+  const std::string &name() const { return label; }
+  uint64_t key() const { return materialKey; }
+  size_t size() const { return placements * 2; }
+
+  // Intent: Get the tables reached by capturing a piece or promoting a pawn, with 3 pieces or more
+  // Pre: None
+  // Post: The names are given by tablebaseName
+  std::vector<std::string> subtables() const {
+    std::string sides[2];
+    for (unsigned i = 0; i < count; ++i)
+      sides[colorOf(pieces[i])] += PIECE_CHARS[makePiece(WHITE, typeOf(pieces[i]))];
+    std::vector<std::string> result;
+    for (Color c : {WHITE, BLACK}) {
+      for (size_t i = 1; i < sides[c].size(); ++i) {
+        std::string side = sides[c];
+        if (count > 3)
+          result.push_back(c == WHITE ? tablebaseName(side.erase(i, 1), sides[BLACK]) : tablebaseName(sides[WHITE], side.erase(i, 1)));
+        for (char promotion : std::string_view("QRBN")) {
+          if (sides[c][i] != 'P')
+            break;
+          side = sides[c];
+          side[i] = promotion;
+          result.push_back(c == WHITE ? tablebaseName(side, sides[BLACK]) : tablebaseName(sides[WHITE], side));
+        }
+      }
+    }
+    std::sort(result.begin(), result.end());
+    result.erase(std::unique(result.begin(), result.end()), result.end());
+    return result;
+  }
+
+  // Intent: Get the entry of a placement, the smallest one among its mirror images
+  // Pre: squares lists count squares in the order of the pieces
+  // Post: result < size()
+  size_t entry(const uint8_t *squares, Color stm) const {
+    size_t best = SIZE_MAX;
+    for (unsigned t = 0; t < (pawns ? 2u : 8u); ++t) {
+      int slot = (pawns ? PAWN_SLOTS : SLOTS)[mirror(squares[0], t)];
+      if (slot < 0)
+        continue;
+      uint8_t image[TB_MAX_PIECES];
+      for (unsigned i = 1; i < count; ++i)
+        image[i] = mirror(squares[i], t);
+      // two pieces of the same kind are listed by increasing square
+      for (unsigned i = 3; i < count; ++i)
+        if (pieces[i] == pieces[i - 1] && image[i] < image[i - 1])
+          std::swap(image[i], image[i - 1]);
+      size_t placement = size_t(slot);
+      for (unsigned i = 1; i < count; ++i)
+        placement = placement * 64 + image[i];
+      best = std::min(best, placement * 2 + stm);
+    }
+    return best;
+  }
+
+  // Intent: Get the entry of a position of this material, seen with the colors swapped if flip is set
+  // Pre: materialKey(pos, flip) == key()
+  // Post: result < size()
+  size_t entry(const Position &pos, bool flip) const {
+    uint8_t squares[TB_MAX_PIECES];
+    Bitboard group = 0;
+    for (unsigned i = 0; i < count; ++i) {
+      Piece p = Piece(pieces[i] ^ (flip ? 8 : 0));
+      if (!i || pieces[i] != pieces[i - 1])
+        group = pos.pieces(colorOf(p), typeOf(p));
+      squares[i] = popLsb(group) ^ (flip ? 56 : 0);
+    }
+    return entry(squares, Color(pos.activeColor ^ flip));
+  }
+
+  // Intent: Get the squares and the side to move of an entry
+  // Pre: e < size()
+  // Post: The squares may overlap, the placement is only checked by validEntry
+  void unpack(size_t e, uint8_t *squares, Color &stm) const {
+    stm = Color(e & 1);
+    size_t placement = e >> 1;
+    for (unsigned i = count - 1; i; --i, placement /= 64)
+      squares[i] = uint8_t(placement % 64);
+    squares[0] = pawns ? PAWN_SLOT_SQUARES[placement] : SLOT_SQUARES[placement];
+  }
+
+  // Intent: Build the position of a placement, without castling rights and en passant square
+  // Pre: The squares do not overlap
+  // Post: None
+  Position position(const uint8_t *squares, Color stm) const {
+    Position pos{};
+    pos.enPassant = NO_SQUARE;
+    pos.fullmoveNumber = 1;
+    pos.activeColor = stm;
+    for (unsigned i = 0; i < count; ++i)
+      pos.put(squares[i], pieces[i]);
+    return pos;
+  }
+
+  // Intent: Check if the squares of an entry are distinct, no pawn stands on the first or last
+  //         rank and the entry is the one its placement maps to
+  // Pre: squares and stm were filled by unpack(e, ...)
+  // Post: The side not to move may still be in check
+  bool validEntry(size_t e, const uint8_t *squares, Color stm) const {
+    Bitboard occupied = 0;
+    for (unsigned i = 0; i < count; ++i) {
+      if (occupied & bit(squares[i]) || (typeOf(pieces[i]) == PAWN && (squares[i] < 8 || squares[i] >= 56)))
+        return false;
+      occupied |= bit(squares[i]);
+    }
+    return entry(squares, stm) == e;
+  }
+
+  // Intent: List the distinct entries of the positions from which the side not to move reaches
+  //         the placement by a move that neither captures nor promotes
+  // Pre: The placement is valid, out has room for 256 entries
+  // Post: Return the number of entries, only positions whose side not to move is not in check
+  unsigned predecessors(const uint8_t *squares, Color stm, uint32_t *out) const {
+    Color mover = Color(!stm);
+    Bitboard occupied = 0;
+    for (unsigned i = 0; i < count; ++i)
+      occupied |= bit(squares[i]);
+
+    uint8_t moved[TB_MAX_PIECES];
+    std::copy_n(squares, count, moved);
+    unsigned found = 0;
+    for (unsigned i = 0; i < count; ++i) {
+      if (colorOf(pieces[i]) != mover)
+        continue;
+      uint8_t to = squares[i];
+      Bitboard from = attacks(pieces[i], to, occupied) & ~occupied;
+      if (typeOf(pieces[i]) == PAWN) {
+        // white pawns came from below (larger squares), never from the first rank
+        int back = mover == WHITE ? 8 : -8;
+        uint8_t one = uint8_t(to + back), two = uint8_t(to + 2 * back);
+        from = 0;
+        if (one >= 8 && one < 56 && !(occupied & bit(one))) {
+          from |= bit(one);
+          if (to / 8 == (mover == WHITE ? 4 : 3) && !(occupied & bit(two)))
+            from |= bit(two);
+        }
+      }
+      while (from) {
+        moved[i] = popLsb(from);
+        Bitboard before = occupied ^ bit(to) ^ bit(moved[i]);
+        if (!isAttacked(moved, moved[colorOf(pieces[0]) == stm ? 0 : 1], mover, before))
+          out[found++] = uint32_t(entry(moved, mover));
+      }
+      moved[i] = to;
+    }
+    std::sort(out, out + found);
+    return unsigned(std::unique(out, out + found) - out);
+  }
+
+  // Intent: Get the stored value of an entry
+  // Pre: e < size()
+  // Post: None
+  TbResult at(size_t e) const {
+    return {TbWdl((wdl[e / 32] >> 2 * (e % 32)) & 3), dtm[e]};
+  }
+
+  // Intent: Store the value of an entry
+  // Pre: e < size(), only one thread stores into the same 32 entries at a time
+  // Post: None
+  void set(size_t e, TbResult result) {
+    wdl[e / 32] = (wdl[e / 32] & ~(uint64_t(3) << 2 * (e % 32))) | uint64_t(result.wdl) << 2 * (e % 32);
+    dtm[e] = result.dtm;
+  }
+
+  // Intent: Write the table, the name and then the packed values and the distances
+  // Pre: None
+  // Post: None
+  void save(std::ostream &out) const {
+    uint32_t header[2] = {TB_VERSION, uint32_t(label.size())};
+    out.write(TB_MAGIC, 4);
+    out.write(reinterpret_cast<const char *>(header), sizeof(header));
+    out.write(label.data(), std::streamsize(label.size()));
+    out.write(reinterpret_cast<const char *>(wdl.data()), std::streamsize(wdl.size() * sizeof(uint64_t)));
+    out.write(reinterpret_cast<const char *>(dtm.data()), std::streamsize(dtm.size()));
+  }
+
+  // Intent: Read a table written by save
+  // Pre: None
+  // Post: table is only replaced if the result is TB_OK
+  static TbStatus load(std::istream &in, std::unique_ptr<TbTable> &table) {
+    char magic[4];
+    uint32_t header[2];
+    if (!in.read(magic, 4) || !std::equal(magic, magic + 4, TB_MAGIC))
+      return TB_BAD_MAGIC;
+    if (!in.read(reinterpret_cast<char *>(header), sizeof(header)))
+      return TB_TRUNCATED;
+    if (header[0] != TB_VERSION)
+      return TB_BAD_VERSION;
+    std::string name(std::min(header[1], 16u), '\0');
+    if (!in.read(name.data(), std::streamsize(name.size())))
+      return TB_TRUNCATED;
+    auto next = fromName(name);
+    if (!next || next->name() != name)
+      return TB_BAD_NAME;
+    if (!in.read(reinterpret_cast<char *>(next->wdl.data()), std::streamsize(next->wdl.size() * sizeof(uint64_t)))
+        || !in.read(reinterpret_cast<char *>(next->dtm.data()), std::streamsize(next->dtm.size())))
+      return TB_TRUNCATED;
+    table = std::move(next);
+    return TB_OK;
+  }
+
+  Piece pieces[TB_MAX_PIECES] = {};
+  unsigned count = 0;
+
+private:
+  TbTable() = default;
+
+  // Intent: Map a square by one of the 8 symmetries of the board, bit 2 of t swaps files and
+  //         ranks, bit 0 mirrors the files and bit 1 the ranks
+  // Pre: t < 8
+  // Post: None
+  static constexpr uint8_t mirror(uint8_t sq, unsigned t) {
+    if (t & 4)
+      sq = uint8_t((sq & 7) << 3 | sq >> 3);
+    return sq ^ (t & 1 ? 7 : 0) ^ (t & 2 ? 56 : 0);
+  }
+
+  // Intent: Get the squares a piece attacks, pawns excluded
+  // Pre: None
+  // Post: None
+  static Bitboard attacks(Piece p, uint8_t sq, Bitboard occupied) {
+    switch (typeOf(p)) {
+      case PAWN: return PAWN_ATTACKS[colorOf(p)][sq];
+      case KNIGHT: return KNIGHT_ATTACKS[sq];
+      case BISHOP: return bishopAttacks(sq, occupied);
+      case ROOK: return rookAttacks(sq, occupied);
+      case QUEEN: return bishopAttacks(sq, occupied) | rookAttacks(sq, occupied);
+      default: return KING_ATTACKS[sq];
+    }
+  }
+
+  // Intent: Check if a piece of color by attacks target in a placement
+  // Pre: None
+  // Post: None
+  bool isAttacked(const uint8_t *squares, uint8_t target, Color by, Bitboard occupied) const {
+    for (unsigned i = 0; i < count; ++i)
+      if (colorOf(pieces[i]) == by && attacks(pieces[i], squares[i], occupied) & bit(target))
+        return true;
+    return false;
+  }
+
+  // Slot of each square of the white king, -1 outside a8-d8-d5 and outside the files a to d
+  static constexpr auto SLOTS = [] {
+    std::array<int8_t, 64> slots{};
+    int8_t next = 0;
+    for (uint8_t sq = 0; sq < 64; ++sq)
+      slots[sq] = sq % 8 <= 3 && sq / 8 <= sq % 8 ? next++ : -1;
+    return slots;
+  }();
+  static constexpr auto PAWN_SLOTS = [] {
+    std::array<int8_t, 64> slots{};
+    int8_t next = 0;
+    for (uint8_t sq = 0; sq < 64; ++sq)
+      slots[sq] = sq % 8 <= 3 ? next++ : -1;
+    return slots;
+  }();
+  static constexpr auto SLOT_SQUARES = [] {
+    std::array<uint8_t, 10> squares{};
+    for (uint8_t sq = 0; sq < 64; ++sq)
+      if (SLOTS[sq] >= 0)
+        squares[SLOTS[sq]] = sq;
+    return squares;
+  }();
+  static constexpr auto PAWN_SLOT_SQUARES = [] {
+    std::array<uint8_t, 32> squares{};
+    for (uint8_t sq = 0; sq < 64; ++sq)
+      if (PAWN_SLOTS[sq] >= 0)
+        squares[PAWN_SLOTS[sq]] = sq;
+    return squares;
+  }();
+
+  std::string label;
+  uint64_t materialKey = 0;
+  bool pawns = false;
+  size_t placements = 0;
+  std::vector<uint64_t> wdl;  // 2 bits of TbWdl per entry
+  std::vector<uint8_t> dtm;
+};
+
+// Every generated or loaded table, probed by the material of a position in either color
+class Tablebase {
+public:
+  using TableCallback = std::function<void(const TbTable &, double seconds)>;
+
+  // Intent: Generate a table and, before it, every missing table it captures or promotes into
+  // Pre: None
+  // Post: onTable is called after each generated table, nothing is done for known materials
+  TbStatus generate(std::string_view name, WorkerPool &pool, const TableCallback &onTable = {}) {
+    std::unique_ptr<TbTable> table = TbTable::fromName(name);
+    if (!table)
+      return TB_BAD_NAME;
+    if (find(table->key()) || find(flipMaterial(table->key())))
+      return TB_OK;
+    for (const std::string &sub : table->subtables())
+      if (TbStatus status = generate(sub, pool, onTable))
+        return status;
+
+    auto start = std::chrono::steady_clock::now();
+    build(*table, pool);
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    tables.push_back(std::move(table));
+    if (onTable)
+      onTable(*tables.back(), seconds);
+    return TB_OK;
+  }
+
+  // Intent: Add a table read from a file, see TbTable::load
+  // Pre: None
+  // Post: A table of the same material is replaced
+  TbStatus load(std::istream &in) {
+    std::unique_ptr<TbTable> table;
+    if (TbStatus status = TbTable::load(in, table))
+      return status;
+    std::erase_if(tables, [&](const auto &known) {
+      return known->key() == table->key() || known->key() == flipMaterial(table->key());
+    });
+    tables.push_back(std::move(table));
+    return TB_OK;
+  }
+
+  const std::vector<std::unique_ptr<TbTable>> &all() const { return tables; }
+
+  // Intent: Look up a position without castling rights and without an en passant capture
+  // Pre: None
+  // Post: Return false if no table holds the position, the fifty-move rule is not taken into account
+  bool probe(const Position &pos, TbResult &result) const {
+    if (popCount(pos.occupied()) > int(TB_MAX_PIECES) || pos.castlingRights)
+      return false;
+    if (pos.enPassant != NO_SQUARE && PAWN_ATTACKS[!pos.activeColor][pos.enPassant] & pos.pieces(pos.activeColor, PAWN))
+      return false;
+    for (bool flip : {false, true}) {
+      if (const TbTable *table = find(materialKey(pos, flip))) {
+        result = table->at(table->entry(pos, flip));
+        return result.wdl != TB_INVALID;
+      }
+    }
+    return false;
+  }
+
+private:
+  // Entry values while a table is built, the kind in the high byte and the plies in the low byte
+  enum : uint16_t { UNKNOWN, BUILD_WIN = 1 << 8, BUILD_LOSS = 2 << 8, BUILD_INVALID = 3 << 8, BUILD_DRAW = 4 << 8 };
+  static constexpr uint8_t CANNOT_LOSE = 255;
+  static constexpr size_t BLOCK = 4096;
+
+  const TbTable *find(uint64_t key) const {
+    for (const auto &table : tables)
+      if (table->key() == key)
+        return table.get();
+    return nullptr;
+  }
+
+  // Intent: Fill a table by retrograde analysis. Each position first counts its distinct
+  //         successors within the table and takes the values of its captures and promotions
+  //         from the subtables. Then, ply by ply from the mates on, a lost position makes
+  //         its predecessors won and a won position takes one successor off the count of
+  //         its predecessors, which are lost once none is left.
+  // Pre: Every subtable is known
+  // Post: Positions that are never decided are draws
+  void build(TbTable &table, WorkerPool &pool) const {
+    size_t size = table.size();
+    std::vector<uint16_t> value(size, UNKNOWN);
+    std::vector<uint8_t> successors(size, 0), lossFloor(size, 0);
+    std::vector<std::vector<uint32_t>> buckets(256);
+    std::vector<std::vector<std::vector<uint32_t>>> found(pool.size(), buckets);
+    auto collect = [&] {
+      for (auto &worker : found)
+        for (size_t d = 0; d < 256; ++d)
+          buckets[d].insert(buckets[d].end(), worker[d].begin(), worker[d].end()), worker[d].clear();
+    };
+
+    // successors, terminal positions and the values of leaving the table
+    pool.run((size + BLOCK - 1) / BLOCK, [&](size_t block, unsigned worker) {
+      for (size_t e = block * BLOCK; e < std::min(size, (block + 1) * BLOCK); ++e) {
+        uint8_t squares[TB_MAX_PIECES];
+        Color stm;
+        table.unpack(e, squares, stm);
+        if (!table.validEntry(e, squares, stm)) {
+          value[e] = BUILD_INVALID;
+          continue;
+        }
+        Position pos = table.position(squares, stm);
+        if (pos.attackersTo(pos.kingSquare[!stm], pos.occupied()) & pos.byColor[stm]) {
+          value[e] = BUILD_INVALID;
+          continue;
+        }
+
+        MoveList moves;
+        generateLegalMoves(pos, moves);
+        if (!moves.size()) {
+          value[e] = pos.inCheck() ? BUILD_LOSS : BUILD_DRAW;
+          if (pos.inCheck())
+            found[worker][0].push_back(uint32_t(e));
+          continue;
+        }
+
+        unsigned win = 256, floor = 0, quiet = 0;
+        bool cannotLose = false;
+        uint32_t children[MAX_MOVES];
+        for (const Move &m : moves) {
+          UndoInfo undo = makeMove(pos, m);
+          if (undo.captured != NO_PIECE || m.flag() == PROMOTION) {
+            TbResult child{TB_DRAW, 0};
+            if (popCount(pos.occupied()) > 2)
+              probe(pos, child);
+            if (child.wdl == TB_LOSS)
+              win = std::min(win, child.dtm + 1u);
+            else if (child.wdl == TB_WIN)
+              floor = std::max(floor, child.dtm + 1u);
+            else
+              cannotLose = true;
+          } else {
+            children[quiet++] = uint32_t(table.entry(pos, false));
+          }
+          unmakeMove(pos, m, undo);
+        }
+        std::sort(children, children + quiet);
+        successors[e] = uint8_t(std::unique(children, children + quiet) - children);
+        lossFloor[e] = cannotLose ? CANNOT_LOSE : uint8_t(floor);
+        if (win < 256) {
+          value[e] = uint16_t(BUILD_WIN | win);
+          found[worker][win].push_back(uint32_t(e));
+        } else if (!successors[e] && !cannotLose) {
+          value[e] = uint16_t(BUILD_LOSS | floor);
+          found[worker][floor].push_back(uint32_t(e));
+        }
+      }
+    });
+    collect();
+
+    // positions decided at depth plies decide their predecessors at depth + 1 or later
+    for (unsigned depth = 0; depth < 255; ++depth) {
+      std::vector<uint32_t> frontier = std::move(buckets[depth]);
+      pool.run((frontier.size() + BLOCK - 1) / BLOCK, [&](size_t block, unsigned worker) {
+        uint32_t parents[256];
+        for (size_t i = block * BLOCK; i < std::min(frontier.size(), (block + 1) * BLOCK); ++i) {
+          uint32_t e = frontier[i];
+          uint16_t decided = std::atomic_ref(value[e]).load(std::memory_order_relaxed);
+          if ((decided & 255) != depth)
+            continue;  // a shorter win was found after it was queued
+
+          uint8_t squares[TB_MAX_PIECES];
+          Color stm;
+          table.unpack(e, squares, stm);
+          unsigned count = table.predecessors(squares, stm, parents);
+          for (unsigned j = 0; j < count; ++j) {
+            uint32_t parent = parents[j];
+            std::atomic_ref parentValue(value[parent]);
+            if ((decided & 0xFF00) == BUILD_LOSS) {
+              uint16_t current = parentValue.load(std::memory_order_relaxed);
+              uint16_t win = uint16_t(BUILD_WIN | (depth + 1));
+              while (current == UNKNOWN || ((current & 0xFF00) == BUILD_WIN && current > win)) {
+                if (parentValue.compare_exchange_weak(current, win, std::memory_order_relaxed)) {
+                  found[worker][depth + 1].push_back(parent);
+                  break;
+                }
+              }
+            } else if (std::atomic_ref(successors[parent]).fetch_sub(1, std::memory_order_relaxed) == 1
+                       && lossFloor[parent] != CANNOT_LOSE) {
+              unsigned lossDepth = std::max(depth + 1, unsigned(lossFloor[parent]));
+              uint16_t expected = UNKNOWN;
+              if (parentValue.compare_exchange_strong(expected, uint16_t(BUILD_LOSS | lossDepth), std::memory_order_relaxed))
+                found[worker][lossDepth].push_back(parent);
+            }
+          }
+        }
+      });
+      collect();
+    }
+
+    // 32 entries share a word of the packed values
+    pool.run((size + BLOCK - 1) / BLOCK, [&](size_t block, unsigned) {
+      for (size_t e = block * BLOCK; e < std::min(size, (block + 1) * BLOCK); ++e) {
+        switch (value[e] & 0xFF00) {
+          case BUILD_WIN: table.set(e, {TB_WIN, uint8_t(value[e])}); break;
+          case BUILD_LOSS: table.set(e, {TB_LOSS, uint8_t(value[e])}); break;
+          case BUILD_INVALID: table.set(e, {TB_INVALID, 0}); break;
+          default: table.set(e, {TB_DRAW, 0}); break;
+        }
+      }
+    });
+  }
+
+  std::vector<std::unique_ptr<TbTable>> tables;
+};
@@ -0,0 +1,233 @@
+/***************************************************************************
+ * File: tt.h
+ * Author: 朱昱綸 (B11115022@mail.ntust.edu.tw)
+ *         張庭嘉 (B11115027@mail.ntust.edu.tw)
+ *         顏毓德 (B11115038@mail.ntust.edu.tw)
+ *         黃雋祐 (B11115048@mail.ntust.edu.tw)
+ * Create Date: Oct 16, 2026
+ * Update Date: Oct 16, 2026
+ * Description: Lockless transposition table shared by search and perft,
+ *              keyed by Position::key. (C++20)
+***************************************************************************/
+// Include guard
+#pragma once
+
+// Necessary headers
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include "movegen.h"
+
+// Meaning of a stored search score
+enum Bound : uint8_t { BOUND_NONE, BOUND_UPPER, BOUND_LOWER, BOUND_EXACT };
+
+// Which entry of a full bucket a store overwrites
+enum ReplacePolicy : uint8_t {
+  REPLACE_DEPTH_AGE, // the shallowest entry, entries of older searches count as shallower
+  REPLACE_DEPTH,     // the shallowest entry
+  REPLACE_OLDEST,    // the entry of the oldest search
+};
+
+// A search result, unpacked from the 64-bit payload of a slot
+struct TTEntry {
+  Move move;
+  int16_t score;
+  uint8_t depth;
+  Bound bound;
+  uint8_t age;
+};
+
+// Counters of probe and store outcomes, kept by the caller: threads sharing the table would
+// otherwise all write to the same cache line on every probe
+struct TTStats {
+  uint64_t hits;
+  uint64_t misses;
+  uint64_t stores;
+  uint64_t collisions; // stores that overwrote another position
+
+  constexpr TTStats &operator+=(const TTStats &other) {
+    hits += other.hits;
+    misses += other.misses;
+    stores += other.stores;
+    collisions += other.collisions;
+    return *this;
+  }
+};
+
+// Every slot holds (key ^ data, data), a torn write from another thread makes the two words
+// disagree and the slot reads as a miss, so no lock is needed. The low 16 bits of data are
+// depth (bits 0-7), bound (bits 8-9) and age (bits 10-15), the rest is the payload:
+// move (bits 16-31) and score (bits 32-47) for search, or the node count (bits 16-63) for perft
+class TranspositionTable {
+public:
+  static constexpr size_t SLOTS = 4;
+
+  // Intent: Allocate a table of at most the given size
+  // Pre: None
+  // Post: Every slot is empty
+  explicit TranspositionTable(size_t megabytes = 16, ReplacePolicy policy = REPLACE_DEPTH_AGE) : policy(policy) {
+    resize(megabytes);
+  }
+
+  // Intent: Reallocate the table, the bucket count is rounded down to a power of two
+  // Pre: None
+  // Post: Every slot is empty, at least one bucket is allocated
+  void resize(size_t megabytes) {
+    size_t count = std::bit_floor(std::max<size_t>(megabytes * 1024 * 1024 / sizeof(Bucket), 1));
+    buckets = std::make_unique<Bucket[]>(count);
+    mask = count - 1;
+    clear();
+  }
+
+  // Intent: Empty every slot
+  // Pre: No other thread uses the table
+  // Post: None
+  void clear() {
+    for (size_t i = 0; i <= mask; ++i)
+      for (auto &word : buckets[i].words)
+        word.store(0, std::memory_order_relaxed);
+    age = 0;
+  }
+
+  // Intent: Start a new search, entries of earlier searches become replaceable first
+  // Pre: No other thread uses the table if searches are independent
+  // Post: None
+  void newSearch() {
+    age = (age + 1) & 63;
+    // after 64 searches the age bits repeat and an old entry would look current again
+    if (independent && !age)
+      clear();
+  }
+
+  // Intent: Make every search start from what amounts to an empty table, without clearing it
+  //         each time: entries of earlier searches read as misses and are replaced first
+  // Pre: None
+  // Post: None
+  void setIndependentSearches(bool on) { independent = on; }
+
+  void setPolicy(ReplacePolicy p) { policy = p; }
+  size_t sizeInBytes() const { return (mask + 1) * sizeof(Bucket); }
+
+  // Intent: Look up the search result of a position
+  // Pre: None
+  // Post: Return false if the position is not stored, entry is unspecified in that case
+  bool probe(uint64_t key, TTEntry &entry) {
+    uint64_t data;
+    if (!probeData(key, data))
+      return false;
+    entry = {Move{uint16_t(data >> 16)}, int16_t(data >> 32), uint8_t(data), Bound((data >> 8) & 3), uint8_t((data >> 10) & 63)};
+    return true;
+  }
+
+  // Intent: Store the search result of a position
+  // Pre: None
+  // Post: Return true if the result overwrote another position
+  bool store(uint64_t key, Move move, int16_t score, uint8_t depth, Bound bound) {
+    return storeData(key, depth | (uint64_t(bound) << 8) | (uint64_t(move.data) << 16) | (uint64_t(uint16_t(score)) << 32), true);
+  }
+
+  // Intent: Look up the perft node count of a position at the given depth
+  // Pre: None
+  // Post: Return false if it is not stored
+  bool probeNodes(uint64_t key, uint8_t depth, uint64_t &nodes) {
+    uint64_t data;
+    if (!probeData(key, data) || uint8_t(data) != depth)
+      return false;
+    nodes = data >> 16;
+    return true;
+  }
+
+  // Intent: Store the perft node count of a position at the given depth
+  // Pre: nodes < 2^48
+  // Post: Return true if the count overwrote another position
+  bool storeNodes(uint64_t key, uint8_t depth, uint64_t nodes) { return storeData(key, depth | (nodes << 16)); }
+
+private:
+  // One cache line of SLOTS (key ^ data, data) pairs
+  struct alignas(64) Bucket {
+    std::atomic<uint64_t> words[2 * SLOTS];
+  };
+
+  static_assert(sizeof(Bucket) == 64);
+
+  static constexpr uint64_t MOVE_BITS = 0xFFFF'0000;
+
+  // Intent: Check if a stored payload may be used, only entries of the current search count
+  //         when searches are independent
+  // Pre: None
+  // Post: None
+  bool isCurrent(uint64_t data) const { return !independent || !data || ((data >> 10) & 63) == age; }
+
+  // Intent: Find the payload stored for key
+  // Pre: None
+  // Post: Return false if key is not in its bucket
+  bool probeData(uint64_t key, uint64_t &data) {
+    Bucket &bucket = buckets[key & mask];
+    for (size_t i = 0; i < SLOTS; ++i) {
+      uint64_t check = bucket.words[2 * i].load(std::memory_order_relaxed);
+      data = bucket.words[2 * i + 1].load(std::memory_order_relaxed);
+      if ((check ^ data) == key && data && isCurrent(data))
+        return true;
+    }
+    return false;
+  }
+
+  // Intent: Store a payload for key, reusing its slot or evicting one chosen by the policy.
+  //         A search result stored over the same position keeps the old move if it has none
+  //         (quiescence stores Move{}), and is dropped if it is not exact and shallower than
+  //         the entry of the current search, which would lose that entry's deeper bound.
+  // Pre: The age bits of data are 0
+  // Post: Return true if another position was evicted
+  bool storeData(uint64_t key, uint64_t data, bool searchResult = false) {
+    Bucket &bucket = buckets[key & mask];
+    data |= uint64_t(age) << 10;
+
+    size_t victim = 0;
+    int victimValue = INT32_MAX;
+    for (size_t i = 0; i < SLOTS; ++i) {
+      uint64_t check = bucket.words[2 * i].load(std::memory_order_relaxed);
+      uint64_t old = bucket.words[2 * i + 1].load(std::memory_order_relaxed);
+      if (!isCurrent(old)) {
+        // as good as empty, but a later slot may still hold key
+        if (victimValue != INT32_MIN + 1) {
+          victim = i;
+          victimValue = INT32_MIN + 1;
+        }
+        continue;
+      }
+      if (!old || (check ^ old) == key) {
+        if (old && searchResult) {
+          if (uint8_t(old) > uint8_t(data) && ((data >> 8) & 3) != BOUND_EXACT && ((old >> 10) & 63) == age)
+            return false;
+          if (!(data & MOVE_BITS))
+            data |= old & MOVE_BITS;
+        }
+        victim = i;
+        victimValue = INT32_MIN;
+        break;
+      }
+
+      // lower values are evicted first
+      int depth = uint8_t(old), ageDistance = (age - (old >> 10)) & 63;
+      int value = policy == REPLACE_DEPTH ? depth : policy == REPLACE_OLDEST ? -ageDistance : depth - 8 * ageDistance;
+      if (value < victimValue) {
+        victim = i;
+        victimValue = value;
+      }
+    }
+
+    bucket.words[2 * victim].store(key ^ data, std::memory_order_relaxed);
+    bucket.words[2 * victim + 1].store(data, std::memory_order_relaxed);
+    // neither the same position nor an entry that reads as empty
+    return victimValue > INT32_MIN + 1;
+  }
+
+  std::unique_ptr<Bucket[]> buckets;
+  size_t mask = 0;
+  uint8_t age = 0;
+  bool independent = false;
+  ReplacePolicy policy;
+};
@@ -0,0 +1,57 @@
+/***************************************************************************
+ * File: zobrist.h
+ * Author: 朱昱綸 (B11115022@mail.ntust.edu.tw)
+ *         張庭嘉 (B11115027@mail.ntust.edu.tw)
+ *         顏毓德 (B11115038@mail.ntust.edu.tw)
+ *         黃雋祐 (B11115048@mail.ntust.edu.tw)
+ * Create Date: Oct 16, 2026
+ * Update Date: Oct 16, 2026
+ * Description: Random keys of the 64-bit Zobrist position hash, generated
+ *              at compile time. (C++20)
+***************************************************************************/
+// Include guard
+#pragma once
+
+// Necessary headers
+#include <array>
+#include <cstdint>
+
+// Intent: Get the next number of a SplitMix64 sequence
+// Pre: None
+// Post: state is advanced
+constexpr uint64_t splitMix64(uint64_t &state) {
+  uint64_t z = (state += 0x9E3779B97F4A7C15ull);
+  z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+  z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+  return z ^ (z >> 31);
+}
+
+// Every key of the hash, the key of a position is the xor of the keys of its features
+struct ZobristKeys {
+  uint64_t piece[16][64];  // indexed by [Piece][square], piece[NO_PIECE] is unused
+  uint64_t castling[16];   // indexed by the whole castling rights bitmask
+  uint64_t enPassant[8];   // indexed by the file of the en passant target square
+  uint64_t blackToMove;
+};
+
+constexpr ZobristKeys ZOBRIST = [] {
+  ZobristKeys keys{};
+  uint64_t state = 0x5EED'C0DE'CAFE'F00Dull;
+  for (auto &squares : keys.piece)
+    for (uint64_t &key : squares)
+      key = splitMix64(state);
+
+  // each right gets its own key so that castling[a | b] == castling[a] ^ castling[b]
+  uint64_t rights[4];
+  for (uint64_t &key : rights)
+    key = splitMix64(state);
+  for (unsigned mask = 0; mask < 16; ++mask)
+    for (unsigned i = 0; i < 4; ++i)
+      if (mask & (1 << i))
+        keys.castling[mask] ^= rights[i];
+
+  for (uint64_t &key : keys.enPassant)
+    key = splitMix64(state);
+  keys.blackToMove = splitMix64(state);
+  return keys;
+}();